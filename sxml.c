@@ -1,13 +1,10 @@
 #include "sxml.h"
+#include "sxml_internal.h"
 
 /* The following functions will need to be replaced if you want no dependency to libc: */
 #include <string.h>	/* memchr, memcmp, strlen, memcpy */
 #include <assert.h>	/* assert */
-
-typedef unsigned UINT;
-typedef int BOOL;
-#define FALSE	0
-#define TRUE	(!FALSE)
+#include <limits.h>	/* UINT_MAX */
 
 /*
  MARK: String
@@ -144,6 +141,168 @@ static const char* str_find_notalnum (const char* start, const char* end)
 	return it;
 }
 
+/*
+ MARK: UTF-8
+ Ascii bytes are skipped a machine word at a time - only multibyte sequences are decoded.
+*/
+
+static const char* str_find_notascii (const char* start, const char* end)
+{
+	const char* it;
+	assert (start <= end);
+
+	for (it= start; (size_t) (end - it) >= sizeof (WORD); it+= sizeof (WORD))
+	{
+		WORD w;
+		memcpy (&w, it, sizeof (WORD));
+		if (w & WORD_HIGHBITS)
+			break;
+	}
+
+	for (; it != end && !(*it & 0x80); it++)
+		;
+
+	return it;
+}
+
+/* Returns number of continuation bytes following a lead byte - or -1 if not a valid lead byte */
+static int utf8_seqlen (int c)
+{
+	if (c < 0x80)
+		return 0;
+	else if (c < 0xC2)	/* Continuation byte or overlong 2 byte sequence */
+		return -1;
+	else if (c < 0xE0)
+		return 1;
+	else if (c < 0xF0)
+		return 2;
+	else if (c < 0xF5)
+		return 3;
+
+	return -1;	/* Beyond U+10FFFF */
+}
+
+/* Returns start of first invalid or incomplete utf-8 sequence - 'end' if all text is valid */
+static const char* utf8_findinvalid (const char* start, const char* end)
+{
+	const unsigned char* it= (const unsigned char*) start;
+	const unsigned char* uend= (const unsigned char*) end;
+	assert (start <= end);
+
+	for (;;)
+	{
+		int c, i, n;
+		UINT lo= 0x80, hi= 0xBF;
+
+		it= (const unsigned char*) str_find_notascii ((const char*) it, end);
+		if (it == uend)
+			return end;
+
+		c= *it;
+		n= utf8_seqlen (c);
+		if (n < 0 || uend - it <= n)
+			return (const char*) it;
+
+		/* Reject overlong encodings, surrogates and code points beyond U+10FFFF */
+		switch (c)
+		{
+			case 0xE0:	lo= 0xA0;	break;
+			case 0xED:	hi= 0x9F;	break;
+			case 0xF0:	lo= 0x90;	break;
+			case 0xF4:	hi= 0x8F;	break;
+		}
+
+		if (it[1] < lo || hi < it[1])
+			return (const char*) it;
+
+		for (i= 2; i <= n; i++)
+		{
+			if ((it[i] & 0xC0) != 0x80)
+				return (const char*) it;
+		}
+
+		it+= n + 1;
+	}
+}
+
+/* Returns start of a trailing multibyte sequence cut short by 'end' - 'end' if there is none */
+static const char* utf8_findtail (const char* start, const char* end)
+{
+	const char* it;
+	assert (start <= end);
+
+	for (it= end; it != start && end - it < 4; )
+	{
+		int n, c= (unsigned char) *--it;
+		if ((c & 0xC0) == 0x80)
+			continue;
+
+		n= utf8_seqlen (c);
+		return (0 < n && end - it <= n) ? it : end;
+	}
+
+	return end;
+}
+
+/*
+ MARK: Lines
+ Newlines are counted a machine word at a time.
+*/
+
+/* Returns number of bytes equal to 'c' in word */
+static UINT word_countbyte (WORD w, int c)
+{
+	WORD x= w ^ (WORD_ONES * (unsigned char) c);
+
+	/* High bit is set for every non-zero byte - without carry between bytes */
+	WORD t= ((x & ~WORD_HIGHBITS) + ~WORD_HIGHBITS) | x;
+	WORD found= (~t & WORD_HIGHBITS) >> 7;
+
+	return (UINT) ((found * WORD_ONES) >> ((sizeof (WORD) - 1) * 8));
+}
+
+UINT sxml_countlines (const char* start, const char* end, const char** linestart)
+{
+	const char* it, *lastword= NULL;
+	UINT n= 0;
+	assert (start <= end);
+
+	*linestart= start;
+	for (it= start; (size_t) (end - it) >= sizeof (WORD); it+= sizeof (WORD))
+	{
+		WORD w;
+		UINT found;
+
+		memcpy (&w, it, sizeof (WORD));
+		found= word_countbyte (w, '\n');
+		if (found != 0)
+		{
+			n+= found;
+			lastword= it;
+		}
+	}
+
+	if (lastword != NULL)
+	{
+		const char* nl= lastword + sizeof (WORD);
+		while (*--nl != '\n')
+			;
+
+		*linestart= nl + 1;
+	}
+
+	for (; it != end; it++)
+	{
+		if (*it == '\n')
+		{
+			n++;
+			*linestart= it + 1;
+		}
+	}
+
+	return n;
+}
+
 /* MARK: State */
 
 /* Collect arguments in a structure for convenience */
@@ -153,25 +312,47 @@ typedef struct
 	UINT bufferlen;
 	sxmltok_t* tokens;
 	UINT num_tokens;
+	const sxmlalloc_t* alloc;	/* Token table is grown when full if set - see parse_grow() */
+	BOOL skip;	/* Construct being parsed is not emitted - see sxml_t 'skipmask' */
+	UINT tokenlimit;	/* Parsing yields once 'ntokens' reaches this - zero for no limit */
 } sxml_args_t;
 
 #define buffer_fromoffset(args,i)	((args)->buffer + (i))
 #define buffer_tooffset(args,ptr)	(unsigned) ((ptr) - (args)->buffer)
 #define buffer_getend(args) ((args)->buffer + (args)->bufferlen)
 
-static BOOL state_pushtoken (sxml_t* state, sxml_args_t* args, sxmltype_t type, const char* start, const char* end)
+#define TOKENS_MINGROW	64
+
+static BOOL args_growtokens (sxml_args_t* args)
 {
-	sxmltok_t* token;
-	UINT i= state->ntokens++;
-	if (args->num_tokens < state->ntokens)
+	UINT num_tokens= (args->num_tokens < TOKENS_MINGROW) ? TOKENS_MINGROW : args->num_tokens * 2;
+	void* tokens;
+
+	/* Size of the doubled table in bytes must fit the allocator's 'newsize' */
+	if (args->num_tokens > UINT_MAX / 2 / sizeof (sxmltok_t))
 		return FALSE;
-	
-	token= &args->tokens[i];
-	token->type= type;
-	token->startpos= buffer_tooffset (args, start);
-	token->endpos= buffer_tooffset (args, end);
-	token->size= 0;
 
+	tokens= args->alloc->grow (args->alloc->user, args->tokens, args->num_tokens * sizeof (sxmltok_t), num_tokens * sizeof (sxmltok_t));
+	if (tokens == NULL)
+		return FALSE;
+
+	args->tokens= (sxmltok_t*) tokens;
+	args->num_tokens= num_tokens;
+	return TRUE;
+}
+
+/* 'skip' is set for each construct - only when a skip mask is set, so it is never written by default */
+#define state_skips(state,type)	(((state)->skipmask & SXML_TYPEMASK (type)) != 0)
+#define state_setskip(state,args,type)	do { if ((state)->skipmask != 0) (args)->skip= state_skips (state, type); } while (0)
+#define state_yields(state,args)	((args)->tokenlimit != 0 && (args)->tokenlimit <= (state)->ntokens)
+
+/* Returns the new token - NULL if it is skipped or there is no room for it */
+static sxmltok_t* state_pushtoken (sxml_t* state, sxml_args_t* args, sxmltype_t type, const char* start, const char* end)
+{
+	sxmltok_t* token;
+	UINT i;
+
+	/* Elements are tracked even when skipped */
 	switch (type)
 	{
 		case SXML_STARTTAG:	state->taglevel++;	break;
@@ -185,7 +366,21 @@ static BOOL state_pushtoken (sxml_t* state, sxml_args_t* args, sxmltype_t type,
 			break;
 	}
 
-	return TRUE;
+	if (args->skip)
+		return NULL;
+
+	i= state->ntokens++;
+	if (args->num_tokens < state->ntokens)
+		return NULL;
+	
+	token= &args->tokens[i];
+	token->type= (unsigned char) type;
+	token->flags= 0;
+	token->startpos= buffer_tooffset (args, start);
+	token->endpos= buffer_tooffset (args, end);
+	token->size= 0;
+
+	return token;
 }
 
 static sxmlerr_t state_setpos (sxml_t* state, const sxml_args_t* args, const char* ptr)
@@ -194,7 +389,48 @@ static sxmlerr_t state_setpos (sxml_t* state, const sxml_args_t* args, const cha
 	return (state->ntokens <= args->num_tokens) ? SXML_SUCCESS : SXML_ERROR_TOKENSFULL;
 }
 
-#define state_commit(dest,src) memcpy ((dest), (src), sizeof (sxml_t))
+/*
+ The text parsed since the last commit is validated and its lines counted before progress is copied.
+ Only called when one of these flags is set - see state_commit().
+*/
+static sxmlerr_t state_check (sxml_t* dest, const sxml_t* src, const sxml_args_t* args)
+{
+	const char* start= buffer_fromoffset (args, dest->bufferpos);
+	const char* end= buffer_fromoffset (args, src->bufferpos);
+	assert (start <= end);
+
+	if (dest->flags & SXML_FLAG_UTF8)
+	{
+		const char* invalid= utf8_findinvalid (start, end);
+		if (invalid != end)
+		{
+			dest->errorpos= buffer_tooffset (args, invalid);
+			return SXML_ERROR_XMLINVALID;
+		}
+	}
+
+	if (dest->flags & SXML_FLAG_LINES)
+	{
+		const char* linestart;
+		UINT n= sxml_countlines (start, end, &linestart);
+
+		dest->lineno+= n;
+		dest->colno= (n != 0) ? 1 : dest->colno;
+		dest->colno+= (UINT) (end - linestart);
+	}
+
+	return SXML_SUCCESS;
+}
+
+/*
+ Copy parser progress from 'src' to 'dest' - without flags this is only the copy.
+ The fields are copied one at a time: they were just written one at a time, and copying the whole sxml_t in wider moves stalls on that.
+*/
+#define STATE_CHECKFLAGS	(SXML_FLAG_UTF8 | SXML_FLAG_LINES)
+#define state_copy(dest,src)	((dest)->bufferpos= (src)->bufferpos, (dest)->ntokens= (src)->ntokens, (dest)->taglevel= (src)->taglevel, (dest)->textrun= (src)->textrun)
+#define state_commit(dest,src,args) \
+	((((dest)->flags & STATE_CHECKFLAGS) && state_check (dest, src, args) != SXML_SUCCESS) ? SXML_ERROR_XMLINVALID : \
+	(state_copy (dest, src), SXML_SUCCESS))
 
 /*
  MARK: Parse
@@ -210,12 +446,74 @@ static sxmlerr_t state_setpos (sxml_t* state, const sxml_args_t* args, const cha
 #define ENTITY_MAXLEN 8	/* &#x03A3; */
 #define MIN(a,b)	((a) < (b) ? (a) : (b))
 
+/* SXML_FLAG_COALESCE - all character data up to 'end' goes into one token, references are only checked */
+static sxmlerr_t parse_charrun (sxml_t* state, sxml_args_t* args, const char* end)
+{
+	sxmltok_t* token;
+	const char* start= buffer_fromoffset (args, state->bufferpos);
+	const char* it= start;
+	BOOL escaped= FALSE;
+	assert (end <= buffer_getend (args));
+
+	for (;;)
+	{
+		const char* limit, *colon, *ampr= str_findchr (it, end, '&');
+		if (ampr == end)
+		{
+			it= end;
+			break;
+		}
+
+		limit= MIN (ampr + ENTITY_MAXLEN, end);
+		colon= str_findchr (ampr, limit, ';');
+		if (colon == limit)
+		{
+			if (limit != end)
+				return SXML_ERROR_XMLINVALID;
+
+			/* Reference is cut short - leave it for the next token */
+			it= ampr;
+			break;
+		}
+
+		escaped= TRUE;
+		it= colon + 1;
+	}
+
+	if (it == buffer_getend (args) && (state->flags & SXML_FLAG_UTF8))
+		it= utf8_findtail (start, it);
+
+	if (it == start)
+		return SXML_ERROR_BUFFERDRY;
+
+	token= state_pushtoken (state, args, SXML_CHARACTER, start, it);
+	if (token != NULL && escaped)
+		token->flags= SXML_TOKEN_ESCAPED;
+
+	return state_setpos (state, args, it);
+}
+
 static sxmlerr_t parse_characters (sxml_t* state, sxml_args_t* args, const char* end)
 {
 	const char* start= buffer_fromoffset (args, state->bufferpos);
-	const char* limit, *colon, *ampr= str_findchr (start, end, '&');
+	const char* limit, *colon, *ampr;
 	assert (end <= buffer_getend (args));
 
+	if (state->flags & SXML_FLAG_COALESCE)
+		return parse_charrun (state, args, end);
+
+	ampr= str_findchr (start, end, '&');
+
+	/* Don't split a multibyte sequence at the end of the buffer - wait for the rest of it */
+	if (ampr == buffer_getend (args) && (state->flags & SXML_FLAG_UTF8))
+	{
+		ampr= utf8_findtail (start, ampr);
+		if (ampr == start)
+			return SXML_ERROR_BUFFERDRY;
+
+		end= ampr;
+	}
+
 	if (ampr != start)
 		state_pushtoken (state, args, SXML_CHARACTER, start, ampr);
 
@@ -252,7 +550,7 @@ static sxmlerr_t parse_attributes (sxml_t* state, sxml_args_t* args)
 	const char* name= str_ltrim (start, end);
 	
 	UINT ntokens= state->ntokens;
-	assert (0 < ntokens);
+	assert (0 < ntokens || args->skip);
 
 	while (name != end && ISALPHA (*name))
 	{
@@ -289,6 +587,8 @@ static sxmlerr_t parse_attributes (sxml_t* state, sxml_args_t* args)
 		name= str_ltrim (quot + 1, end);
 	}
 
+	/* Owner token may have been skipped or not fit in the token table */
+	if (!args->skip && ntokens <= args->num_tokens)
 	{
 		sxmltok_t* token= args->tokens + (ntokens - 1);
 		token->size= (unsigned short) (state->ntokens - ntokens);
@@ -321,6 +621,7 @@ static sxmlerr_t parse_comment (sxml_t* state, sxml_args_t* args)
 	if (dash == end)
 		return SXML_ERROR_BUFFERDRY;
 
+	state_setskip (state, args, SXML_COMMENT);
 	state_pushtoken (state, args, SXML_COMMENT, start, dash);
 	return state_setpos (state, args, dash + TAG_LEN (ENDTAG));
 }
@@ -344,6 +645,7 @@ static sxmlerr_t parse_instruction (sxml_t* state, sxml_args_t* args)
 	if (space == end)
 		return SXML_ERROR_BUFFERDRY;
 
+	state_setskip (state, args, SXML_INSTRUCTION);
 	state_pushtoken (state, args, SXML_INSTRUCTION, start, space);
 
 	state_setpos (state, args, space);
@@ -380,6 +682,7 @@ static sxmlerr_t parse_doctype (sxml_t* state, sxml_args_t* args)
 	if (bracket == end)
 		return SXML_ERROR_BUFFERDRY;
 
+	state_setskip (state, args, SXML_DOCTYPE);
 	state_pushtoken (state, args, SXML_DOCTYPE, start, bracket);
 	return state_setpos (state, args, bracket + TAG_LEN (ENDTAG));
 }
@@ -402,6 +705,7 @@ static sxmlerr_t parse_start (sxml_t* state, sxml_args_t* args)
 	if (space == end)
 		return SXML_ERROR_BUFFERDRY;
 
+	state_setskip (state, args, SXML_STARTTAG);
 	state_pushtoken (state, args, SXML_STARTTAG, name, space);
 
 	state_setpos (state, args, space);
@@ -448,6 +752,7 @@ static sxmlerr_t parse_end (sxml_t* state, sxml_args_t* args)
 	if (str_ltrim (space, gt) != gt)
 		return SXML_ERROR_XMLSTRICT;
 
+	state_setskip (state, args, SXML_ENDTAG);
 	state_pushtoken (state, args, SXML_ENDTAG, start, space);
 	return state_setpos (state, args, gt + 1);
 }
@@ -471,6 +776,7 @@ static sxmlerr_t parse_cdata (sxml_t* state, sxml_args_t* args)
 	if (bracket == end)
 		return SXML_ERROR_BUFFERDRY;
 
+	state_setskip (state, args, SXML_CDATA);
 	state_pushtoken (state, args, SXML_CDATA, start, bracket);
 	return state_setpos (state, args, bracket + TAG_LEN (ENDTAG));
 }
@@ -485,87 +791,232 @@ void sxml_init (sxml_t *state)
     state->bufferpos= 0;
     state->ntokens= 0;
 	state->taglevel= 0;
+	state->textrun= 0;
+	state->flags= 0;
+	state->errorpos= 0;
+	state->skipmask= 0;
+	state->lineno= 1;
+	state->colno= 1;
+	state->bytebudget= 0;
+	state->tokenbudget= 0;
 }
 
 #define ROOT_FOUND(state)	(0 < (state)->taglevel)
 #define ROOT_PARSED(state)	((state)->taglevel == 0)
 
-sxmlerr_t sxml_parse(sxml_t *state, const char *buffer, UINT bufferlen, sxmltok_t tokens[], UINT num_tokens)
+/* Marks the end of a document when parsing a stream of them */
+static sxmlerr_t state_endrecord (sxml_t* state, sxml_args_t* args)
 {
-	sxml_t temp= *state;
-	const char* end= buffer + bufferlen;
-	
-	sxml_args_t args;
-	args.buffer= buffer;
-	args.bufferlen= bufferlen;
-	args.tokens= tokens;
-	args.num_tokens= num_tokens;
+	const char* pos= buffer_fromoffset (args, state->bufferpos);
+	if (!(state->flags & SXML_FLAG_STREAM))
+		return SXML_SUCCESS;
 
-	/* --- */
+	state_setskip (state, args, SXML_RECORD);
+	state_pushtoken (state, args, SXML_RECORD, pos, pos);
+	return state_setpos (state, args, pos);
+}
 
-	while (!ROOT_FOUND (&temp))
+static sxmlerr_t parse_document (sxml_t* state, sxml_args_t* args)
+{
+	sxml_t temp= *state;
+	const char* end= buffer_getend (args);
+
+	/* There may be more than one document with SXML_FLAG_STREAM */
+	for (;;)
 	{
-		sxmlerr_t err;
-		const char* start= buffer_fromoffset (&args, temp.bufferpos);
-		const char* lt= str_ltrim (start, end);
-		state_setpos (&temp, &args, lt);
-		state_commit (state, &temp);
+		BOOL rootfound= ROOT_FOUND (&temp);
 
-		if (end - lt < TAG_MINSIZE)
-			return SXML_ERROR_BUFFERDRY;
+		while (!rootfound)
+		{
+			sxmlerr_t err;
+			const char* start, *lt;
+			if (state_yields (&temp, args))
+				return SXML_YIELD;
+
+			start= buffer_fromoffset (args, temp.bufferpos);
+			lt= str_ltrim (start, end);
+			state_setpos (&temp, args, lt);
+			err= state_commit (state, &temp, args);
+			if (err != SXML_SUCCESS)
+				return err;
 
-		/* --- */
+			if (end - lt < TAG_MINSIZE)
+				return SXML_ERROR_BUFFERDRY;
 
-		if (*lt != '<')
-			return SXML_ERROR_XMLINVALID;
+			/* --- */
 
-		switch (lt[1])
-		{
-		case '?':	err= parse_instruction (&temp, &args);	break;
-		case '!':	err= parse_doctype (&temp, &args);	break;
-		default:	err= parse_start (&temp, &args);	break;
-		}
+			if (*lt != '<')
+				return SXML_ERROR_XMLINVALID;
 
-		if (err != SXML_SUCCESS)
-			return err;
+			switch (lt[1])
+			{
+			case '?':	err= parse_instruction (&temp, args);	break;
+			case '!':	err= (lt[2] == '-') ? parse_comment (&temp, args) : parse_doctype (&temp, args);	break;
+			default:	err= parse_start (&temp, args);	rootfound= TRUE;	break;
+			}
 
-		state_commit (state, &temp);
-	}
+			if (err != SXML_SUCCESS)
+				return err;
 
-	/* --- */
+			/* Root element may be empty */
+			if (rootfound && ROOT_PARSED (&temp))
+			{
+				err= state_endrecord (&temp, args);
+				if (err != SXML_SUCCESS)
+					return err;
+			}
 
-	while (!ROOT_PARSED (&temp))
-	{
-		sxmlerr_t err;
-		const char* start= buffer_fromoffset (&args, temp.bufferpos);
-		const char* lt= str_findchr (start, end, '<');
-		while (buffer_fromoffset (&args, temp.bufferpos) != lt)
-		{
-			sxmlerr_t err= parse_characters (&temp, &args, lt);
+			err= state_commit (state, &temp, args);
 			if (err != SXML_SUCCESS)
 				return err;
-
-			state_commit (state, &temp);
 		}
 
 		/* --- */
 
-		if (end - lt < TAG_MINSIZE)
-			return SXML_ERROR_BUFFERDRY;
-
-		switch (lt[1])
+		while (!ROOT_PARSED (&temp))
 		{
-		case '?':	err= parse_instruction (&temp, &args);		break;
-		case '/':	err= parse_end (&temp, &args);	break;
-		case '!':	err= (lt[2] == '-') ? parse_comment (&temp, &args) : parse_cdata (&temp, &args);	break;
-		default:	err= parse_start (&temp, &args);	break;
+			sxmlerr_t err;
+			const char* start, *lt;
+			if (state_yields (&temp, args))
+				return SXML_YIELD;
+
+			start= buffer_fromoffset (args, temp.bufferpos);
+			lt= str_findchr (start, end, '<');
+
+			/* The rest of a run of text cut short by a previous call is never whitespace-only on its own */
+			if ((temp.flags & SXML_FLAG_NOSPACE) && !temp.textrun && start != lt && str_ltrim (start, lt) == lt)
+			{
+				/* Whitespace may be followed by more text - wait until the whole run is in the buffer */
+				if (lt == end)
+					return SXML_ERROR_BUFFERDRY;
+
+				state_setpos (&temp, args, lt);
+			}
+
+			state_setskip (&temp, args, SXML_CHARACTER);
+
+			while (buffer_fromoffset (args, temp.bufferpos) != lt)
+			{
+				sxmlerr_t err= parse_characters (&temp, args, lt);
+				if (err != SXML_SUCCESS)
+					return err;
+
+				temp.textrun= 1;
+				err= state_commit (state, &temp, args);
+				if (err != SXML_SUCCESS)
+					return err;
+
+				if (state_yields (&temp, args))
+					return SXML_YIELD;
+			}
+
+			/* --- */
+
+			if (end - lt < TAG_MINSIZE)
+				return SXML_ERROR_BUFFERDRY;
+
+			switch (lt[1])
+			{
+			case '?':	err= parse_instruction (&temp, args);		break;
+			case '/':	err= parse_end (&temp, args);	break;
+			case '!':	err= (lt[2] == '-') ? parse_comment (&temp, args) : parse_cdata (&temp, args);	break;
+			default:	err= parse_start (&temp, args);	break;
+			}
+
+			if (err != SXML_SUCCESS)
+				return err;
+
+			temp.textrun= 0;
+			if (ROOT_PARSED (&temp))
+			{
+				err= state_endrecord (&temp, args);
+				if (err != SXML_SUCCESS)
+					return err;
+			}
+
+			err= state_commit (state, &temp, args);
+			if (err != SXML_SUCCESS)
+				return err;
 		}
 
-		if (err != SXML_SUCCESS)
+		if (!(temp.flags & SXML_FLAG_STREAM))
+			return SXML_SUCCESS;
+	}
+}
+
+/*
+ The token table is only grown once it turned out to be too small - the default path never looks at the allocator.
+ Like a caller handling SXML_ERROR_TOKENSFULL, the construct that did not fit is parsed again from the last commit.
+*/
+static sxmlerr_t parse_grow (sxml_t* state, sxml_args_t* args)
+{
+	for (;;)
+	{
+		sxmlerr_t err= parse_document (state, args);
+		if (err != SXML_ERROR_TOKENSFULL || args->alloc == NULL || !args_growtokens (args))
+			return err;
+	}
+}
+
+/*
+ The byte budget is applied by cutting the buffer short - to the parser it looks like the buffer ran dry.
+ Running dry at the cut is reported as SXML_YIELD, as long as something was parsed.
+*/
+static sxmlerr_t parse_budget (sxml_t* state, sxml_args_t* args)
+{
+	const UINT bufferlen= args->bufferlen;
+	UINT window= state->bytebudget;
+
+	args->tokenlimit= (state->tokenbudget != 0) ? state->ntokens + state->tokenbudget : 0;
+	if (window == 0)
+		return parse_grow (state, args);
+
+	for (;;)
+	{
+		const UINT bufferpos= state->bufferpos;
+		sxmlerr_t err;
+
+		args->bufferlen= (bufferlen - bufferpos <= window) ? bufferlen : bufferpos + window;
+		err= parse_grow (state, args);
+		if (err != SXML_ERROR_BUFFERDRY || args->bufferlen == bufferlen)
 			return err;
 
-		state_commit (state, &temp);
+		if (state->bufferpos != bufferpos)
+			return SXML_YIELD;
+
+		/* A single construct is larger than the budget - going over it is better than never getting past it */
+		window= (window < (bufferlen - bufferpos) / 2) ? window * 2 : bufferlen - bufferpos;
 	}
+}
 
-	return SXML_SUCCESS;
+sxmlerr_t sxml_parse(sxml_t *state, const char *buffer, UINT bufferlen, sxmltok_t tokens[], UINT num_tokens)
+{
+	sxml_args_t args;
+	args.buffer= buffer;
+	args.bufferlen= bufferlen;
+	args.tokens= tokens;
+	args.num_tokens= num_tokens;
+	args.alloc= NULL;
+	args.skip= FALSE;
+
+	return parse_budget (state, &args);
+}
+
+sxmlerr_t sxml_parse_alloc(sxml_t *state, const char *buffer, UINT bufferlen, sxmltok_t** tokens, UINT* num_tokens, const sxmlalloc_t* alloc)
+{
+	sxmlerr_t err;
+	sxml_args_t args;
+	args.buffer= buffer;
+	args.bufferlen= bufferlen;
+	args.tokens= *tokens;
+	args.num_tokens= *num_tokens;
+	args.alloc= alloc;
+	args.skip= FALSE;
+
+	err= parse_budget (state, &args);
+
+	/* Table may have moved even if parsing did not complete */
+	*tokens= args.tokens;
+	*num_tokens= args.num_tokens;
+	return err;
 }
@@ -19,13 +19,15 @@ typedef enum
 	SXML_ERROR_XMLINVALID= -1,	/* Parser found invalid XML data - not much you can do beyond error reporting */
 	SXML_SUCCESS= 0,			/* Parser has completed successfully - parsing of XML document is complete */
 	SXML_ERROR_BUFFERDRY= 1,	/* Parser ran out of input data - refill buffer with more XML text to continue parsing */
-	SXML_ERROR_TOKENSFULL= 2	/* Parser has filled all the supplied tokens with data - provide more tokens for further output */
+	SXML_ERROR_TOKENSFULL= 2,	/* Parser has filled all the supplied tokens with data - provide more tokens for further output */
+	SXML_YIELD= 3				/* Parser has used up the work budget of this call - call it again to continue (see 'bytebudget' below) */
 } sxmlerr_t;
 
 /*
  You provide sxml_parse() with a buffer of XML text for parsing.
  The parser will handle text data encoded in ascii, latin-1 and utf-8.
  It should also work with other encodings that are acsii extensions.
+ Text encoded in utf-16 has to be transcoded first - see sxml_utf16.h.
 
  sxml_parse() is reentrant.
  In the case of return code SXML_ERROR_BUFFERDRY or SXML_ERROR_TOKENSFULL, you are expected to call the function again after resolving the problem to continue parsing.
@@ -47,6 +49,15 @@ struct sxml_t
 	unsigned bufferpos;	/* Current offset into buffer - all XML data before this position has been successfully parsed */
 	unsigned ntokens;	/* Number of tokens filled with valid data by the parser */
 	unsigned taglevel;	/* Used internally - keeps track of number of unclosed XML elements to detect start and end of document */
+	unsigned textrun;	/* Used internally - nonzero while parsing stopped in the middle of a run of text */
+
+	unsigned flags;		/* Optional parser features - any combination of sxmlflag_t described below */
+	unsigned errorpos;	/* Offset into buffer of the offending byte when SXML_FLAG_UTF8 validation fails */
+	unsigned skipmask;	/* Token types the parser should not emit - combine SXML_TYPEMASK() of each sxmltype_t to skip */
+	unsigned lineno;	/* Line and column of 'bufferpos' in the document when SXML_FLAG_LINES is set - both start at 1 */
+	unsigned colno;
+	unsigned bytebudget;	/* Bytes of input and tokens of output after which sxml_parse() returns SXML_YIELD - zero for no limit */
+	unsigned tokenbudget;
 };
 
 /*
@@ -56,6 +67,35 @@ struct sxml_t
 
 void sxml_init(sxml_t *parser);
 
+/*
+ sxml_init() turns off all optional features.
+ You may enable them by setting 'flags' after initialization and before parsing:
+*/
+
+typedef enum
+{
+	SXML_FLAG_UTF8= 1,	/* Validate that all parsed text is well-formed utf-8 - SXML_ERROR_XMLINVALID is returned with 'errorpos' set on failure */
+	SXML_FLAG_NOSPACE= 2,	/* Skip character data between tags that is only whitespace - typically the indentation of pretty printed XML */
+	SXML_FLAG_COALESCE= 4,	/* Emit one SXML_CHARACTER token for a run of text or an attribute value - see SXML_TOKEN_ESCAPED below */
+	SXML_FLAG_LINES= 8,		/* Keep track of the line and column of 'bufferpos' - useful for error reporting */
+	SXML_FLAG_STREAM= 16	/* Keep parsing when the root element is closed - for a stream of concatenated documents */
+} sxmlflag_t;
+
+/*
+ Validation is done on each piece of XML text as it is parsed, so the data is checked while still in cache.
+ Ascii text is skipped a machine word at a time.
+ A SXML_CHARACTER token will never end with an incomplete utf-8 sequence - the parser waits for more data instead.
+
+ Lines are counted in the same way, so you don't have to scan the text again to report where an error is.
+ The column is counted in bytes.
+ Line tracking is unaffected by moving 'bufferpos' when you refill the buffer, but it must not be moved past unparsed data.
+
+ Logs and message queues often hold one small XML document after another.
+ With SXML_FLAG_STREAM the parser continues with the next document - and its prolog - instead of returning SXML_SUCCESS.
+ A SXML_RECORD token is emitted after each complete document, so a single call can return the tokens of many documents.
+ The stream ends where the input does - at that point 'taglevel' is zero if the last document was complete.
+*/
+
 /*
  Unlike most XML parsers, SXML does not use SAX callbacks or allocate a DOM tree.
  Instead you will have to interpret the XML structure through a table of tokens.
@@ -74,9 +114,25 @@ typedef enum
 	/* And some other token types you might be interested in: */
 	SXML_INSTRUCTION,	/* Can be used to identity the text encoding */
 	SXML_DOCTYPE,		/* If you'd like to interpret DTD data */
-	SXML_COMMENT		/* Most likely you don't care about comments - but this is where you'll find them */
+	SXML_COMMENT,		/* Most likely you don't care about comments - but this is where you'll find them */
+
+	SXML_RECORD			/* Marks the end of a document with SXML_FLAG_STREAM - both offsets point just past the end of the root element */
 } sxmltype_t;
 
+/*
+ Token types you don't care about can be skipped by the parser - they will not use any space in the token table.
+ The attributes of a skipped element or instruction are skipped along with it.
+
+ sxml_t parser;
+ sxml_init (&parser);
+ parser.skipmask= SXML_TYPEMASK (SXML_COMMENT) | SXML_TYPEMASK (SXML_INSTRUCTION) | SXML_TYPEMASK (SXML_DOCTYPE);
+ parser.flags= SXML_FLAG_NOSPACE;
+
+ Note that with SXML_FLAG_NOSPACE a run of whitespace has to fit in the buffer before the parser can tell whether it is followed by more text.
+*/
+
+#define SXML_TYPEMASK(type)	(1u << (type))
+
 /*
  If you are familiar with the structure of an XML document most of these type names should sound familiar.
  
@@ -85,7 +141,8 @@ typedef enum
 
 struct sxmltok_t
 {
-	unsigned short type;	/* A token is one of the above sxmltype_t */
+	unsigned char type;		/* A token is one of the above sxmltype_t */
+	unsigned char flags;	/* Additional information about the token text - see sxmltokflag_t at the end of this section */
 	unsigned short size;	/* The following number of tokens contain additional data related to this token - used for describing attributes */
 
 	/* 'startpos' and 'endpos' together define a range within the provided text buffer - use these offsets with the buffer to extract the text value of the token */
@@ -111,6 +168,70 @@ struct sxmltok_t
 
  In our example the token of type SXML_STARTTAG will have a 'size' of 7 (3 SXML_CDATA and 4 SXML_CHARACTER).
  When processing the tokens do not forget about 'size' - for any token you want to skip, also remember to skip the additional token data!
+
+ Splitting text at every reference makes entity heavy text expensive if you don't decode it, or decode it lazily.
+ With SXML_FLAG_COALESCE the parser instead emits a single SXML_CHARACTER token for each attribute value and each run of text between tags.
+ 'three' will then have one token ('Me, Myself &amp; I') and the SXML_STARTTAG will have a 'size' of 5.
+ The token is flagged if you need to look for references in it:
+*/
+
+typedef enum
+{
+	SXML_TOKEN_ESCAPED= 1	/* SXML_CHARACTER token text contains one or more references that need to be unescaped */
+} sxmltokflag_t;
+
+/*
+ A run of text may still be split over several tokens when it does not fit in the buffer.
+*/
+
+/*
+ MARK: Growing the token table
+ Instead of handling SXML_ERROR_TOKENSFULL, you may let the parser grow the token table when it is full.
+ A whole document can then be tokenized in one call.
+ Pass an allocator to sxml_parse_alloc() - 'tokens' and 'num_tokens' are updated whenever the table is moved, even if an error is returned.
+ SXML_ERROR_TOKENSFULL is only returned if the allocator fails, or if the size of the table in bytes would no longer fit in an unsigned.
+
+ The allocator is a single function that returns a block of at least 'newsize' bytes holding the first 'oldsize' bytes of 'ptr'.
+ 'ptr' is NULL the first time. It may simply call realloc(), if you don't mind the dependency to libc.
+ sxml_arena.h has an allocator that works within a block of memory you provide.
+*/
+
+typedef struct sxmlalloc_t sxmlalloc_t;
+struct sxmlalloc_t
+{
+	void* (*grow)(void *user, void *ptr, unsigned oldsize, unsigned newsize);
+	void *user;
+};
+
+sxmlerr_t sxml_parse_alloc(sxml_t *parser, const char *buffer, unsigned bufferlen, sxmltok_t **tokens, unsigned *num_tokens, const sxmlalloc_t *alloc);
+
+/*
+ MARK: Work budget
+ A single call to sxml_parse() runs until the buffer or the token table is used up.
+ If you parse within a frame of a real-time loop, limit the work done per call instead of feeding the parser small buffers.
+ Set 'bytebudget' and/or 'tokenbudget' - both count from where the call started.
+
+ When the budget is used up SXML_YIELD is returned at a point where parsing can continue.
+ Nothing needs resolving - the tokens so far are valid, and you call sxml_parse() again with the same arguments when you have time.
+ You may also process the tokens and reset 'ntokens' first, like for SXML_ERROR_TOKENSFULL.
+
+ The byte budget limits how far ahead the parser looks for the end of a construct, so long runs of text are split into several tokens.
+ A construct is never split otherwise - a start tag or comment larger than 'bytebudget' is parsed in one call that goes over the budget.
+ The token budget is checked between constructs, so a call may emit a few tokens more - an element with many attributes is not split.
+*/
+
+/*
+ MARK: Extras
+ Helpers that are not needed for parsing live in their own files:
+ * sxml_attr.h - hash index for looking up the attributes of a start tag by name
+ * sxml_lines.h - line and column of any token in a document you keep in memory
+ * sxml_reparse.h - update the tokens of a document you keep in memory after an edit
+ * sxml_utf16.h - detect the text encoding and transcode utf-16 to utf-8
+ * sxml_arena.h - allocator for sxml_parse_alloc() that uses a block of memory you provide
+ * sxml_pipe.h - tokenize on one thread while processing tokens on another (requires C11 atomics)
+ * sxml_json.h - streaming conversion of the tokens to JSON or newline delimited JSON
+ * sxml_constexpr.hpp - tokenize XML embedded as a string literal at compile time (requires C++20)
+ * sxml_async.hpp - coroutine reader that waits for input from non-blocking connections (requires C++20)
 */
 
 #ifdef __cplusplus
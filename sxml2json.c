@@ -0,0 +1,183 @@
+#include "sxml_json.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+typedef unsigned UINT;
+
+/*
+ MARK: Output
+ Collects the many small pieces written by the transcoder before passing them on to stdout.
+*/
+
+#define OUTPUT_MAXLEN	(64 * 1024)
+
+typedef struct output_t output_t;
+struct output_t
+{
+	char data[OUTPUT_MAXLEN];
+	UINT len;
+};
+
+static void output_flush (output_t* out)
+{
+	fwrite (out->data, 1, out->len, stdout);
+	out->len= 0;
+}
+
+static void output_write (void* user, const char* data, UINT len)
+{
+	output_t* out= (output_t*) user;
+	if (OUTPUT_MAXLEN - out->len < len)
+	{
+		output_flush (out);
+		if (OUTPUT_MAXLEN < len)
+		{
+			fwrite (data, 1, len, stdout);
+			return;
+		}
+	}
+
+	memcpy (out->data + out->len, data, len);
+	out->len+= len;
+}
+
+/*
+ MARK: main
+ Converts a XML file to JSON using fixed size buffers - the input may be of any size.
+
+ Usage: sxml2json [-d depth] file.xml
+
+ Each root element is written as one line of JSON - the file may contain any number of XML documents one after another.
+ With '-d 1' each child of the root element is written on its own line instead.
+*/
+
+#define MIN(a,b)	(((a) < (b)) ? (a) : (b))
+#define COUNT(arr)	(sizeof (arr) / sizeof ((arr)[0]))
+
+#define BUFFER_MAXLEN	(256 * 1024)
+
+static char buffer[BUFFER_MAXLEN];
+static sxmltok_t tokens[4096];
+static output_t output;
+
+static void convert_tokens (sxmljson_t* json, sxml_t* parser)
+{
+	if (sxml_json_write (json, buffer, tokens, parser->ntokens) != SXML_SUCCESS)
+	{
+		fprintf (stderr, "Elements nested too deep near line %d\n", parser->lineno);
+		exit (EXIT_FAILURE);
+	}
+
+	parser->ntokens= 0;
+}
+
+int main (int argc, const char* argv[])
+{
+	UINT bufferlen= 0;
+	const char* path;
+	FILE* file;
+
+	sxml_t parser;
+	sxmljson_t json;
+
+	sxml_init (&parser);
+	parser.flags= SXML_FLAG_COALESCE | SXML_FLAG_NOSPACE | SXML_FLAG_STREAM | SXML_FLAG_LINES;
+
+	sxml_json_init (&json);
+	json.write= output_write;
+	json.user= &output;
+
+	if (argc == 4 && strcmp (argv[1], "-d") == 0)
+	{
+		json.recorddepth= (UINT) atoi (argv[2]);
+		path= argv[3];
+	}
+	else if (argc == 2)
+	{
+		path= argv[1];
+	}
+	else
+	{
+		fprintf (stderr, "Usage: sxml2json [-d depth] file.xml\n");
+		return EXIT_FAILURE;
+	}
+
+	file= fopen (path, "rb");
+	if (file == NULL)
+	{
+		perror (path);
+		return EXIT_FAILURE;
+	}
+
+	for (;;)
+	{
+		sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, COUNT (tokens));
+		if (err == SXML_SUCCESS)
+			break;
+
+		switch (err)
+		{
+			case SXML_ERROR_TOKENSFULL:
+				convert_tokens (&json, &parser);
+				break;
+
+			case SXML_ERROR_BUFFERDRY:
+			{
+				size_t len;
+
+				/* Tokens refer to the buffer - convert them before it is overwritten */
+				convert_tokens (&json, &parser);
+
+				bufferlen-= parser.bufferpos;
+				memmove (buffer, buffer + parser.bufferpos, bufferlen);
+				parser.bufferpos= 0;
+
+				/* A single token that doesn't fit in the buffer would never make progress */
+				if (bufferlen == BUFFER_MAXLEN)
+				{
+					fprintf (stderr, "Token too large at line %d, column %d\n", parser.lineno, parser.colno);
+					return EXIT_FAILURE;
+				}
+
+				len= fread (buffer + bufferlen, 1, BUFFER_MAXLEN - bufferlen, file);
+				if (len == 0)
+				{
+					/* Input may end between any two documents */
+					if (parser.taglevel == 0 && bufferlen == 0)
+						goto done;
+
+					fprintf (stderr, "Unexpected end of input at line %d, column %d\n", parser.lineno, parser.colno);
+					return EXIT_FAILURE;
+				}
+
+				bufferlen+= (UINT) len;
+				break;
+			}
+
+			case SXML_ERROR_XMLINVALID:
+			{
+				char fmt[8];
+
+				fprintf (stderr, "Error while parsing line %d, column %d:\n", parser.lineno, parser.colno);
+				sprintf (fmt, "%%.%ds", MIN (bufferlen - parser.bufferpos, 72));
+				fprintf (stderr, fmt, buffer + parser.bufferpos);
+				fprintf (stderr, "\n");
+				return EXIT_FAILURE;
+			}
+
+			default:
+				assert (0);
+				break;
+		}
+	}
+
+done:
+	fclose (file);
+
+	convert_tokens (&json, &parser);
+	output_flush (&output);
+	return EXIT_SUCCESS;
+}
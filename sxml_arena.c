@@ -0,0 +1,57 @@
+#include "sxml_arena.h"
+
+#include <string.h>	/* memcpy */
+
+typedef unsigned UINT;
+
+#define MIN(a,b)	((a) < (b) ? (a) : (b))
+
+/*
+ MARK: Arena
+ Allocations are never freed - but the last allocation can grow in place.
+*/
+
+typedef union
+{
+	long l;
+	double d;
+	void* p;
+} sxml_align_t;
+
+#define ARENA_ALIGN(n)	(((n) + sizeof (sxml_align_t) - 1) / sizeof (sxml_align_t) * sizeof (sxml_align_t))
+
+void sxml_arena_init (sxmlarena_t* arena, void* memory, UINT size)
+{
+	arena->memory= (char*) memory;
+	arena->size= size;
+	arena->used= 0;
+	arena->last= 0;
+}
+
+void* sxml_arena_grow (void* user, void* ptr, UINT oldsize, UINT newsize)
+{
+	sxmlarena_t* arena= (sxmlarena_t*) user;
+	char* block;
+
+	/* Extend last allocation in place */
+	if (ptr != NULL && (char*) ptr == arena->memory + arena->last)
+	{
+		if (arena->size - arena->last < newsize)
+			return NULL;
+
+		arena->used= arena->last + newsize;
+		return ptr;
+	}
+
+	if (arena->size - arena->used < ARENA_ALIGN (arena->used) - arena->used + newsize)
+		return NULL;
+
+	arena->last= ARENA_ALIGN (arena->used);
+	arena->used= arena->last + newsize;
+
+	block= arena->memory + arena->last;
+	if (ptr != NULL)
+		memcpy (block, ptr, MIN (oldsize, newsize));
+
+	return block;
+}
@@ -0,0 +1,46 @@
+#ifndef _SXML_ARENA_H_INCLUDED
+#define _SXML_ARENA_H_INCLUDED
+
+#include "sxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ --- SXML arena ---
+ Optional allocator for sxml_parse_alloc().
+ No memory allocation is done by SXML itself, but you can hand it a block of memory to use as an arena.
+ The token table is grown geometrically - in place if it is the last allocation from the arena.
+
+ static char memory[65536];
+ sxmlarena_t arena;
+ sxmlalloc_t alloc;
+ sxmltok_t* tokens= NULL;
+ unsigned num_tokens= 0;
+
+ sxml_arena_init (&arena, memory, sizeof (memory));
+ alloc.grow= sxml_arena_grow;
+ alloc.user= &arena;
+ err= sxml_parse_alloc (&parser, buffer, bufferlen, &tokens, &num_tokens, &alloc);
+
+ 'memory' should be suitably aligned for any type.
+*/
+
+typedef struct sxmlarena_t sxmlarena_t;
+struct sxmlarena_t
+{
+	char *memory;
+	unsigned size;
+	unsigned used;
+	unsigned last;	/* Offset of last allocation */
+};
+
+void sxml_arena_init(sxmlarena_t *arena, void *memory, unsigned size);
+void* sxml_arena_grow(void *arena, void *ptr, unsigned oldsize, unsigned newsize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SXML_ARENA_H_INCLUDED */
@@ -0,0 +1,455 @@
+#ifndef _SXML_ASYNC_HPP_INCLUDED
+#define _SXML_ASYNC_HPP_INCLUDED
+
+#include "sxml.h"
+
+#include <coroutine>	/* std::coroutine_handle, std::suspend_always */
+#include <exception>	/* std::terminate */
+#include <cassert>	/* assert */
+#include <cstring>	/* std::memcpy, std::memmove */
+
+#ifdef __linux__
+#include <cerrno>	/* errno */
+#include <unistd.h>	/* read, close */
+#include <sys/epoll.h>	/* epoll_create1, epoll_ctl, epoll_wait */
+#endif
+
+/*
+ --- SXML async ---
+ Optional C++20 coroutine reader for XML arriving over non-blocking connections.
+ Instead of turning SXML_ERROR_BUFFERDRY into a state machine of your own, the reader waits for more input with co_await.
+ The tokens come out as batches of an async generator - one thread can serve many connections, each with a small fixed buffer.
+
+ sxml::detached handle_connection (sxml::fd_source& source)
+ {
+	char buffer[4096];
+	sxmltok_t tokens[256];
+	sxml_t parser;
+	sxml_init (&parser);
+
+	auto batches= sxml::parse_async (source, parser, buffer, sizeof (buffer), tokens, 256);
+	while (const sxml::batch* batch= co_await batches.next ())
+	{
+		... process 'batch->ntokens' tokens of 'batch->tokens' with 'batch->buffer'
+		... 'batch->err' of the last batch is SXML_SUCCESS or SXML_ERROR_XMLINVALID
+	}
+ }
+
+ The batches follow the same rules as those of sxml_pipe.h.
+ A batch is only valid until you ask for the next one - the buffer is refilled in between.
+ SXML_ERROR_XMLINVALID is also reported if the input ends before the document, or a single token does not fit in the buffer.
+ With SXML_FLAG_STREAM the input may end after any complete document.
+
+ Set a work budget on the parser ('bytebudget' in sxml.h) to have the reader return a batch at least that often.
+ The source, parser and memory you pass must outlive the generator.
+
+ Fairness between connections is up to you.
+ A batch with SXML_YIELD goes straight to your handler like any other - the reader does not give up the thread by itself.
+ A connection with a lot of input already buffered keeps the thread until it runs dry, unless the handler lets the others go first:
+
+	if (batch->err == SXML_YIELD)
+		co_await loop.reschedule ();
+
+ epoll_loop::reschedule() resumes the handler from the next call to run(), after the readers whose input has arrived.
+*/
+
+namespace sxml
+{
+	struct batch
+	{
+		const char* buffer;
+		const sxmltok_t* tokens;
+		unsigned ntokens;
+		sxmlerr_t err;
+	};
+
+	/* MARK: Async generator */
+
+	/* Coroutine that produces values for another coroutine - whoever waits on next() is resumed with each value */
+	template <class T>
+	class async_generator
+	{
+	public:
+		struct promise_type;
+		using handle_t= std::coroutine_handle<promise_type>;
+
+		/* Resumes the waiting consumer when the generator yields or finishes */
+		struct yield_awaiter
+		{
+			bool await_ready () noexcept	{ return false; }
+			std::coroutine_handle<> await_suspend (handle_t h) noexcept	{ return h.promise ().consumer; }
+			void await_resume () noexcept	{}
+		};
+
+		struct promise_type
+		{
+			T value;
+			bool done= false;
+			std::coroutine_handle<> consumer;
+
+			async_generator get_return_object ()	{ return async_generator (handle_t::from_promise (*this)); }
+			std::suspend_always initial_suspend () noexcept	{ return {}; }
+			yield_awaiter final_suspend () noexcept	{ return {}; }
+
+			yield_awaiter yield_value (const T& v)
+			{
+				value= v;
+				return {};
+			}
+
+			void return_void ()	{ done= true; }
+			void unhandled_exception ()	{ std::terminate (); }
+		};
+
+		struct next_awaiter
+		{
+			handle_t generator;
+
+			bool await_ready () noexcept	{ return false; }
+
+			std::coroutine_handle<> await_suspend (std::coroutine_handle<> consumer) noexcept
+			{
+				generator.promise ().consumer= consumer;
+				return generator;
+			}
+
+			/* NULL once the generator has finished */
+			const T* await_resume () noexcept
+			{
+				promise_type& promise= generator.promise ();
+				return promise.done ? nullptr : &promise.value;
+			}
+		};
+
+		explicit async_generator (handle_t h) : generator (h)	{}
+		async_generator (async_generator&& other) noexcept : generator (other.generator)	{ other.generator= nullptr; }
+		async_generator (const async_generator&)= delete;
+		async_generator& operator= (const async_generator&)= delete;
+
+		~async_generator ()
+		{
+			if (generator)
+				generator.destroy ();
+		}
+
+		/* Must not be called again after it returned NULL */
+		next_awaiter next ()
+		{
+			assert (!generator.promise ().done);
+			return next_awaiter {generator};
+		}
+
+	private:
+		handle_t generator;
+	};
+
+	/* Fire and forget coroutine - for connection handlers if you don't have a task type of your own */
+	struct detached
+	{
+		struct promise_type
+		{
+			detached get_return_object ()	{ return {}; }
+			std::suspend_never initial_suspend () noexcept	{ return {}; }
+			std::suspend_never final_suspend () noexcept	{ return {}; }
+			void return_void ()	{}
+			void unhandled_exception ()	{ std::terminate (); }
+		};
+	};
+
+	/*
+	 MARK: Reader
+	 A source provides two functions:
+
+	 long read (char* buffer, unsigned len);	- bytes read, zero at the end of input, or -1 if no data is available right now
+	 awaitable readable ();	- resumes the reader once read() may have data again
+	*/
+
+	template <class Source>
+	async_generator<batch> parse_async (Source& source, sxml_t& parser, char* buffer, unsigned buffersize, sxmltok_t* tokens, unsigned num_tokens)
+	{
+		unsigned bufferlen= 0;
+		parser.bufferpos= 0;
+		parser.ntokens= 0;
+
+		for (;;)
+		{
+			sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, num_tokens);
+			switch (err)
+			{
+				case SXML_ERROR_TOKENSFULL:
+				case SXML_YIELD:
+					/* Parser made no progress - it would keep returning the same */
+					if (err == SXML_ERROR_TOKENSFULL && parser.ntokens == 0)
+						err= SXML_ERROR_XMLINVALID;
+
+					co_yield batch {buffer, tokens, parser.ntokens, err};
+					if (err == SXML_ERROR_XMLINVALID)
+						co_return;
+
+					parser.ntokens= 0;
+					break;
+
+				case SXML_ERROR_BUFFERDRY:
+				{
+					long n;
+
+					/* Tokens refer to the buffer - hand them out before it is refilled */
+					if (parser.ntokens != 0)
+					{
+						co_yield batch {buffer, tokens, parser.ntokens, err};
+						parser.ntokens= 0;
+					}
+
+					bufferlen-= parser.bufferpos;
+					std::memmove (buffer, buffer + parser.bufferpos, bufferlen);
+					parser.bufferpos= 0;
+
+					if (bufferlen == buffersize)
+					{
+						co_yield batch {buffer, tokens, 0, SXML_ERROR_XMLINVALID};
+						co_return;
+					}
+
+					while ((n= source.read (buffer + bufferlen, buffersize - bufferlen)) < 0)
+						co_await source.readable ();
+
+					if (n == 0)
+					{
+						/* A stream of documents may end between any two of them */
+						bool streamend= (parser.flags & SXML_FLAG_STREAM) && parser.taglevel == 0 && bufferlen == 0;
+						co_yield batch {buffer, tokens, 0, streamend ? SXML_SUCCESS : SXML_ERROR_XMLINVALID};
+						co_return;
+					}
+
+					bufferlen+= (unsigned) n;
+					break;
+				}
+
+				default:
+					co_yield batch {buffer, tokens, parser.ntokens, err};
+					co_return;
+			}
+		}
+	}
+
+	/*
+	 MARK: Sources
+	 memory_source stands in for a connection in tests - you hand it the input piece by piece with feed().
+	 The reader waiting for input is resumed from within feed() and close().
+	*/
+
+	class memory_source
+	{
+	public:
+		struct awaiter
+		{
+			memory_source& source;
+
+			bool await_ready () noexcept	{ return source.len != 0 || source.closed; }
+			void await_suspend (std::coroutine_handle<> h) noexcept	{ source.waiting= h; }
+			void await_resume () noexcept	{}
+		};
+
+		/* 'data' must stay valid until it has been read - the reader always reads all of it before waiting again */
+		void feed (const char* data, unsigned len)
+		{
+			assert (this->len == 0 && !closed);
+			this->data= data;
+			this->len= len;
+			wake ();
+		}
+
+		void close ()
+		{
+			closed= true;
+			wake ();
+		}
+
+		long read (char* buffer, unsigned buffersize)
+		{
+			unsigned n= (len < buffersize) ? len : buffersize;
+			if (n == 0)
+				return closed ? 0 : -1;
+
+			std::memcpy (buffer, data, n);
+			data+= n;
+			len-= n;
+			return (long) n;
+		}
+
+		awaiter readable ()	{ return awaiter {*this}; }
+
+	private:
+		void wake ()
+		{
+			std::coroutine_handle<> h= waiting;
+			waiting= nullptr;
+			if (h)
+				h.resume ();
+		}
+
+		const char* data= nullptr;
+		unsigned len= 0;
+		bool closed= false;
+		std::coroutine_handle<> waiting;
+	};
+
+#ifdef __linux__
+	/*
+	 fd_source reads from a non-blocking file descriptor, typically a socket.
+	 Waiting readers are resumed by an epoll_loop - call run() from your event loop.
+	 Destroy the source before a generator still waiting on it, so it is no longer watched.
+	*/
+
+	class epoll_loop
+	{
+	public:
+		epoll_loop () : epfd (epoll_create1 (EPOLL_CLOEXEC))	{}
+		epoll_loop (const epoll_loop&)= delete;
+		epoll_loop& operator= (const epoll_loop&)= delete;
+
+		~epoll_loop ()
+		{
+			if (0 <= epfd)
+				::close (epfd);
+		}
+
+		/* Resumes 'h' once when 'fd' is readable - returns false if 'fd' can't be watched */
+		bool watch (int fd, bool added, std::coroutine_handle<> h)
+		{
+			epoll_event ev= {};
+			ev.events= EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+			ev.data.ptr= h.address ();
+			return epoll_ctl (epfd, added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) == 0;
+		}
+
+		void unwatch (int fd)
+		{
+			epoll_ctl (epfd, EPOLL_CTL_DEL, fd, nullptr);
+		}
+
+		/* Queued until the next run() - kept in the frame of the waiting coroutine, so no memory is allocated */
+		struct reschedule_awaiter
+		{
+			epoll_loop& loop;
+			std::coroutine_handle<> handle;
+			reschedule_awaiter* next;
+
+			bool await_ready () noexcept	{ return false; }
+
+			void await_suspend (std::coroutine_handle<> h) noexcept
+			{
+				handle= h;
+				next= nullptr;
+				*loop.readytail= this;
+				loop.readytail= &next;
+			}
+
+			void await_resume () noexcept	{}
+		};
+
+		reschedule_awaiter reschedule ()	{ return reschedule_awaiter {*this, nullptr, nullptr}; }
+
+		/*
+		 Waits up to 'timeout' milliseconds (-1 for no limit) and resumes the readers whose input arrived - returns how many coroutines were resumed.
+		 Coroutines waiting in reschedule() are resumed after those, in the order they were queued - run() does not wait for input if there are any.
+		*/
+		int run (int timeout)
+		{
+			epoll_event events[64];
+			reschedule_awaiter* ready= readyhead;
+			int i, n, resumed= 0;
+
+			/* Rescheduling again during this call waits for the next one */
+			readyhead= nullptr;
+			readytail= &readyhead;
+
+			n= epoll_wait (epfd, events, 64, (ready != nullptr) ? 0 : timeout);
+			for (i= 0; i < n; i++, resumed++)
+				std::coroutine_handle<>::from_address (events[i].data.ptr).resume ();
+
+			while (ready != nullptr)
+			{
+				/* Awaiter is gone once its coroutine continues */
+				reschedule_awaiter* next= ready->next;
+				ready->handle.resume ();
+				ready= next;
+				resumed++;
+			}
+
+			return resumed;
+		}
+
+	private:
+		int epfd;
+		reschedule_awaiter* readyhead= nullptr;
+		reschedule_awaiter** readytail= &readyhead;
+	};
+
+	class fd_source
+	{
+	public:
+		struct awaiter
+		{
+			fd_source& source;
+
+			bool await_ready () noexcept	{ return false; }
+
+			bool await_suspend (std::coroutine_handle<> h) noexcept
+			{
+				if (!source.loop.watch (source.fd, source.added, h))
+				{
+					/* Reported as the end of input - the reader would otherwise wait forever */
+					source.failed= true;
+					return false;
+				}
+
+				source.added= true;
+				return true;
+			}
+
+			void await_resume () noexcept	{}
+		};
+
+		fd_source (int fd, epoll_loop& loop) : fd (fd), loop (loop)	{}
+		fd_source (const fd_source&)= delete;
+		fd_source& operator= (const fd_source&)= delete;
+
+		~fd_source ()
+		{
+			if (added)
+				loop.unwatch (fd);
+		}
+
+		long read (char* buffer, unsigned buffersize)
+		{
+			for (;;)
+			{
+				ssize_t n;
+				if (failed)
+					return 0;
+
+				n= ::read (fd, buffer, buffersize);
+				if (0 <= n)
+					return (long) n;
+
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return -1;
+
+				if (errno != EINTR)
+					failed= true;
+			}
+		}
+
+		awaiter readable ()	{ return awaiter {*this}; }
+
+	private:
+		int fd;
+		epoll_loop& loop;
+		bool added= false;
+		bool failed= false;
+	};
+#endif
+}
+
+#endif /* _SXML_ASYNC_HPP_INCLUDED */
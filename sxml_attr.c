@@ -0,0 +1,71 @@
+#include "sxml_attr.h"
+
+#include <string.h>	/* memcmp */
+#include <assert.h>	/* assert */
+
+typedef unsigned UINT;
+
+/*
+ MARK: Attributes
+ Open addressing with linear probing - keys are hashed with FNV-1a.
+*/
+
+static UINT attr_hash (const char* start, const char* end)
+{
+	UINT hash= 2166136261u;
+	for (; start != end; start++)
+		hash= (hash ^ (unsigned char) *start) * 16777619u;
+
+	return hash;
+}
+
+sxmlerr_t sxml_index_attributes (const char* buffer, const sxmltok_t* token, sxmlattr_t* slots, UINT num_slots)
+{
+	UINT i, nattrs= 0, mask= num_slots - 1;
+	assert (0 < num_slots && (num_slots & mask) == 0);
+
+	for (i= 0; i < num_slots; i++)
+		slots[i].key= 0;
+
+	for (i= 1; i <= token->size; )
+	{
+		const sxmltok_t* key= token + i;
+		UINT hash= attr_hash (buffer + key->startpos, buffer + key->endpos);
+		UINT j, nvalues;
+		assert (key->type == SXML_CDATA);
+
+		/* Keep one slot free to end lookups of missing keys */
+		if (++nattrs == num_slots)
+			return SXML_ERROR_TOKENSFULL;
+
+		for (nvalues= 0; i + nvalues < token->size && key[nvalues + 1].type == SXML_CHARACTER; nvalues++)
+			;
+
+		for (j= hash & mask; slots[j].key != 0; j= (j + 1) & mask)
+			;
+
+		slots[j].hash= hash;
+		slots[j].key= (unsigned short) i;
+		slots[j].nvalues= (unsigned short) nvalues;
+		i+= 1 + nvalues;
+	}
+
+	return SXML_SUCCESS;
+}
+
+const sxmlattr_t* sxml_find_attribute (const char* buffer, const sxmltok_t* token, const sxmlattr_t* slots, UINT num_slots, const char* name, UINT namelen)
+{
+	UINT j, mask= num_slots - 1;
+	UINT hash= attr_hash (name, name + namelen);
+
+	for (j= hash & mask; slots[j].key != 0; j= (j + 1) & mask)
+	{
+		const sxmlattr_t* slot= &slots[j];
+		const sxmltok_t* key= token + slot->key;
+
+		if (slot->hash == hash && key->endpos - key->startpos == namelen && memcmp (buffer + key->startpos, name, namelen) == 0)
+			return slot;
+	}
+
+	return NULL;
+}
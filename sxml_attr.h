@@ -0,0 +1,48 @@
+#ifndef _SXML_ATTR_H_INCLUDED
+#define _SXML_ATTR_H_INCLUDED
+
+#include "sxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ --- SXML attributes ---
+ Optional helper for looking up the attributes of a start tag by name.
+ Finding one attribute by walking the tokens gets slow for elements with many attributes.
+ If you need to look up several, build a hash index over the attributes of the element first.
+
+ You provide the slots - 'num_slots' has to be a power of two and larger than the number of attributes.
+ SXML_ERROR_TOKENSFULL is returned if there are not enough slots.
+
+ Looking up attribute 'three' of the example start tag in sxml.h:
+
+ sxmlattr_t slots[64];
+ if (sxml_index_attributes (buffer, token, slots, 64) == SXML_SUCCESS)
+ {
+	const sxmlattr_t* attr= sxml_find_attribute (buffer, token, slots, 64, "three", 5);
+	if (attr != NULL)
+	{
+		const sxmltok_t* value= token + attr->key + 1;
+		... 'attr->nvalues' tokens starting at 'value' describe the attribute value
+	}
+ }
+*/
+
+typedef struct sxmlattr_t sxmlattr_t;
+struct sxmlattr_t
+{
+	unsigned hash;
+	unsigned short key;		/* Offset from the SXML_STARTTAG token to the SXML_CDATA key token - zero for an unused slot */
+	unsigned short nvalues;	/* Number of SXML_CHARACTER tokens following the key */
+};
+
+sxmlerr_t sxml_index_attributes(const char *buffer, const sxmltok_t *token, sxmlattr_t *slots, unsigned num_slots);
+const sxmlattr_t* sxml_find_attribute(const char *buffer, const sxmltok_t *token, const sxmlattr_t *slots, unsigned num_slots, const char *name, unsigned namelen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SXML_ATTR_H_INCLUDED */
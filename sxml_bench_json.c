@@ -0,0 +1,165 @@
+#include "sxml_json.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef unsigned UINT;
+
+/*
+ --- JSON benchmark ---
+ Measures the throughput of converting a large feed to newline delimited JSON, the way sxml2json does.
+ The feed is generated in memory and read through the same fixed size buffer and token table as sxml2json.
+ The JSON is counted but not stored, so the numbers do not include writing it anywhere.
+
+ Usage: sxml_bench_json [megabytes]
+
+ Generates a feed of about 'megabytes' of XML (default 64) and reports MB/s of XML input for:
+ * tokenizing only
+ * converting to JSON with each root element on one line
+ * converting to JSON with each child of the root element on its own line
+*/
+
+#define BUFFER_MAXLEN	(256 * 1024)
+#define NUM_TOKENS	4096
+#define NUM_RUNS	3
+
+static char* input;
+static UINT inputlen;
+
+static char buffer[BUFFER_MAXLEN];
+static sxmltok_t tokens[NUM_TOKENS];
+
+/* MARK: Input */
+
+static void input_generate (UINT megabytes)
+{
+	UINT maxlen= megabytes * 1024 * 1024;
+	UINT i;
+
+	input= (char*) malloc (maxlen + 1024);
+	if (input == NULL)
+	{
+		fprintf (stderr, "Out of memory\n");
+		exit (EXIT_FAILURE);
+	}
+
+	inputlen= (UINT) sprintf (input, "<?xml version=\"1.0\"?>\n<feed>\n");
+	for (i= 0; inputlen < maxlen; i++)
+	{
+		inputlen+= (UINT) sprintf (input + inputlen,
+			"  <entry id=\"%u\" updated=\"2024-01-01T00:00:%02uZ\">\n"
+			"    <title>Entry &amp; title %u</title>\n"
+			"    <summary>Some text with &lt;markup&gt; and a \"quote\" in it, long enough to look like a summary.</summary>\n"
+			"    <link href=\"http://example.com/%u\"/>\n"
+			"  </entry>\n", i, i % 60, i, i);
+	}
+
+	inputlen+= (UINT) sprintf (input + inputlen, "</feed>\n");
+}
+
+/* MARK: Conversion */
+
+static void output_count (void* user, const char* data, UINT len)
+{
+	(void) data;
+	*(unsigned long*) user+= len;
+}
+
+/* Returns the number of bytes of JSON written - or of tokens if 'json' is NULL */
+static unsigned long convert (sxmljson_t* json)
+{
+	UINT bufferlen= 0, pos= 0;
+	unsigned long ntokens= 0;
+	sxml_t parser;
+
+	sxml_init (&parser);
+	parser.flags= SXML_FLAG_COALESCE | SXML_FLAG_NOSPACE | SXML_FLAG_STREAM;
+
+	for (;;)
+	{
+		sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, NUM_TOKENS);
+		ntokens+= parser.ntokens;
+
+		if (json != NULL && sxml_json_write (json, buffer, tokens, parser.ntokens) != SXML_SUCCESS)
+			err= SXML_ERROR_XMLINVALID;
+
+		parser.ntokens= 0;
+		if (err == SXML_ERROR_BUFFERDRY)
+		{
+			UINT n= BUFFER_MAXLEN - (bufferlen - parser.bufferpos);
+
+			bufferlen-= parser.bufferpos;
+			memmove (buffer, buffer + parser.bufferpos, bufferlen);
+			parser.bufferpos= 0;
+
+			if (inputlen - pos < n)
+				n= inputlen - pos;
+
+			if (n == 0 && parser.taglevel == 0 && bufferlen == 0)
+				break;
+
+			memcpy (buffer + bufferlen, input + pos, n);
+			pos+= n;
+			bufferlen+= n;
+
+			if (n != 0)
+				continue;
+		}
+
+		if (err != SXML_ERROR_TOKENSFULL)
+		{
+			fprintf (stderr, "Conversion failed with %d\n", err);
+			exit (EXIT_FAILURE);
+		}
+	}
+
+	return (json != NULL) ? *(unsigned long*) json->user : ntokens;
+}
+
+static void run (const char* name, int tojson, UINT recorddepth)
+{
+	double best= -1.0;
+	unsigned long result= 0;
+	int r;
+
+	for (r= 0; r < NUM_RUNS; r++)
+	{
+		unsigned long written= 0;
+		sxmljson_t json;
+		clock_t start;
+		double seconds;
+
+		sxml_json_init (&json);
+		json.recorddepth= recorddepth;
+		json.write= output_count;
+		json.user= &written;
+
+		start= clock ();
+		result= convert (tojson ? &json : NULL);
+		seconds= (double) (clock () - start) / CLOCKS_PER_SEC;
+
+		if (best < 0.0 || seconds < best)
+			best= seconds;
+	}
+
+	printf ("%-24s %14lu %s %10.0f MB/s\n", name, result, tojson ? "bytes " : "tokens", (0.0 < best) ? inputlen / best / 1e6 : 0.0);
+}
+
+/* MARK: main */
+
+int main (int argc, const char* argv[])
+{
+	UINT megabytes= (argc == 2) ? (UINT) atoi (argv[1]) : 64;
+
+	input_generate (megabytes);
+	printf ("%u bytes of XML\n\n", inputlen);
+
+	run ("tokenize only", 0, 0);
+	run ("JSON, depth 0", 1, 0);
+	run ("JSON, depth 1", 1, 1);
+
+	free (input);
+	return EXIT_SUCCESS;
+}
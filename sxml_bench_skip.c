@@ -0,0 +1,138 @@
+#include "sxml.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Skipping benchmark ---
+ Measures what skipping unwanted tokens saves on pretty printed XML.
+ The indentation and comments of such a document use most of the token table - each time it is full the caller has to process the tokens and call sxml_parse() again.
+
+ Usage: sxml_bench_skip [items]
+
+ Generates an indented document of 'items' elements (default 200000) and parses it with a table of 256 tokens.
+ For each combination of skip mask and SXML_FLAG_NOSPACE it reports the tokens emitted, the number of SXML_ERROR_TOKENSFULL cycles and the throughput.
+*/
+
+#define NUM_TOKENS	256
+#define NUM_RUNS	5
+
+#define SKIP_COMMENTS	(SXML_TYPEMASK (SXML_COMMENT) | SXML_TYPEMASK (SXML_INSTRUCTION) | SXML_TYPEMASK (SXML_DOCTYPE))
+
+static char* buffer;
+static UINT bufferlen;
+static sxmltok_t tokens[NUM_TOKENS];
+
+/* MARK: Input */
+
+static void generate (UINT items)
+{
+	UINT i, maxlen= 160 * items + 64;
+	buffer= (char*) malloc (maxlen);
+	if (buffer == NULL)
+	{
+		fprintf (stderr, "Out of memory\n");
+		exit (EXIT_FAILURE);
+	}
+
+	bufferlen= (UINT) sprintf (buffer, "<?xml version=\"1.0\"?>\n<root>\n");
+	for (i= 0; i < items; i++)
+	{
+		bufferlen+= (UINT) sprintf (buffer + bufferlen,
+			"    <item id=\"%u\" kind=\"k%u\">\n"
+			"        <name>Item &amp; %u</name>\n"
+			"        <!-- note -->\n"
+			"        <value>%u</value>\n"
+			"    </item>\n", i, i % 10, i, (i * 7919) % 1000);
+	}
+
+	bufferlen+= (UINT) sprintf (buffer + bufferlen, "</root>\n");
+}
+
+/* MARK: Runs */
+
+typedef struct result_t result_t;
+struct result_t
+{
+	unsigned long tokens;
+	UINT cycles;
+	double seconds;
+};
+
+static result_t run (UINT flags, UINT skipmask)
+{
+	result_t best;
+	int r;
+
+	best.seconds= -1.0;
+	for (r= 0; r < NUM_RUNS; r++)
+	{
+		result_t result;
+		sxmlerr_t err;
+		clock_t start;
+
+		sxml_t parser;
+		sxml_init (&parser);
+		parser.flags= flags;
+		parser.skipmask= skipmask;
+
+		result.tokens= 0;
+		result.cycles= 0;
+
+		start= clock ();
+		while ((err= sxml_parse (&parser, buffer, bufferlen, tokens, NUM_TOKENS)) == SXML_ERROR_TOKENSFULL)
+		{
+			result.tokens+= parser.ntokens;
+			result.cycles++;
+			parser.ntokens= 0;
+		}
+
+		result.tokens+= parser.ntokens;
+		result.seconds= (double) (clock () - start) / CLOCKS_PER_SEC;
+
+		if (err != SXML_SUCCESS)
+		{
+			fprintf (stderr, "Parse failed with %d\n", err);
+			exit (EXIT_FAILURE);
+		}
+
+		if (best.seconds < 0.0 || result.seconds < best.seconds)
+			best= result;
+	}
+
+	return best;
+}
+
+/* MARK: main */
+
+int main (int argc, const char* argv[])
+{
+	UINT items= (argc == 2) ? (UINT) atoi (argv[1]) : 200000;
+	UINT i;
+
+	static const struct { const char* name; UINT flags; UINT skipmask; } configs[]=
+	{
+		{"all tokens", 0, 0},
+		{"skipmask", 0, SKIP_COMMENTS},
+		{"NOSPACE", SXML_FLAG_NOSPACE, 0},
+		{"skipmask + NOSPACE", SXML_FLAG_NOSPACE, SKIP_COMMENTS}
+	};
+
+	generate (items);
+	printf ("%u bytes, %u items, %d tokens per call\n\n", bufferlen, items, NUM_TOKENS);
+	printf ("%-20s %12s %12s %10s\n", "", "tokens", "TOKENSFULL", "MB/s");
+
+	for (i= 0; i < sizeof (configs) / sizeof (configs[0]); i++)
+	{
+		result_t result= run (configs[i].flags, configs[i].skipmask);
+		double mbs= (0.0 < result.seconds) ? bufferlen / result.seconds / 1e6 : 0.0;
+		printf ("%-20s %12lu %12u %10.0f\n", configs[i].name, result.tokens, result.cycles, mbs);
+	}
+
+	free (buffer);
+	return EXIT_SUCCESS;
+}
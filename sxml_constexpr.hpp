@@ -0,0 +1,834 @@
+#ifndef _SXML_CONSTEXPR_HPP_INCLUDED
+#define _SXML_CONSTEXPR_HPP_INCLUDED
+
+#include "sxml.h"
+
+#include <array>	/* std::array */
+#include <cstddef>	/* std::size_t */
+
+/*
+ --- SXML constexpr ---
+ Optional C++20 port of the parser that runs at compile time.
+ Use it for XML embedded in the program as a string literal - the token table is built by the compiler instead of on every start.
+
+ constexpr auto config= sxml::embed<"<config><port>80</port></config>">;
+
+ 'config.buffer' and 'config.tokens' are then used exactly like the output of sxml_parse().
+ The token table holds exactly the tokens of the document - 'config.tokens.size()' is 5 in the example above.
+ Malformed XML is a compile error - the error about sxml::detail::malformed_xml gives the 'Line' and 'Column' of the problem.
+
+ Flags and a skip mask are given as template arguments:
+
+ constexpr auto ui= sxml::embed<R"(<window> ... </window>)", SXML_FLAG_NOSPACE | SXML_FLAG_COALESCE, SXML_TYPEMASK (SXML_COMMENT)>;
+
+ The port follows sxml.c construct by construct and gives the same tokens for the same input.
+ Only a fixed size token table is supported - sxml_parse_alloc() has no equivalent here, and the work budget is ignored.
+ sxml::parse() may also be called at run time, but the C parser is faster there.
+*/
+
+namespace sxml
+{
+	namespace detail
+	{
+		/* MARK: String */
+
+		constexpr const char* str_findchr (const char* start, const char* end, char c)
+		{
+			const char* it;
+			for (it= start; it != end && *it != c; it++)
+				;
+
+			return it;
+		}
+
+		constexpr bool str_startswith (const char* start, const char* end, const char* prefix)
+		{
+			for (; *prefix != '\0'; prefix++, start++)
+			{
+				if (start == end || *start != *prefix)
+					return false;
+			}
+
+			return true;
+		}
+
+		constexpr const char* str_findstr (const char* start, const char* end, const char* needle)
+		{
+			const char* it;
+			for (it= start; it != end; it++)
+			{
+				if (str_startswith (it, end, needle))
+					return it;
+			}
+
+			return end;
+		}
+
+		/* http://www.w3.org/TR/xml11/#sec-common-syn */
+
+		constexpr bool WhiteSpace (int c)
+		{
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+		}
+
+		constexpr bool NameStartChar (int c)
+		{
+			/* We don't perform utf-8 decoding - just accept all characters with hight bit set */
+			if (0x80 <= c)
+				return true;
+
+			return c == ':' || ('A' <= c && c <= 'Z') || c == '_' || ('a' <= c && c <= 'z');
+		}
+
+		constexpr bool NameChar (int c)
+		{
+			return NameStartChar (c) || c == '-' || c == '.' || ('0' <= c && c <= '9');
+		}
+
+		constexpr bool ISSPACE (char c)	{ return WhiteSpace ((unsigned char) c); }
+		constexpr bool ISALPHA (char c)	{ return NameStartChar ((unsigned char) c); }
+		constexpr bool ISALNUM (char c)	{ return NameChar ((unsigned char) c); }
+
+		constexpr const char* str_ltrim (const char* start, const char* end)
+		{
+			const char* it;
+			for (it= start; it != end && ISSPACE (*it); it++)
+				;
+
+			return it;
+		}
+
+		constexpr const char* str_rtrim (const char* start, const char* end)
+		{
+			const char* it;
+			for (it= end; it != start && ISSPACE (it[-1]); it--)
+				;
+
+			return it;
+		}
+
+		constexpr const char* str_find_notalnum (const char* start, const char* end)
+		{
+			const char* it;
+			for (it= start; it != end && ISALNUM (*it); it++)
+				;
+
+			return it;
+		}
+
+		/* MARK: UTF-8 */
+
+		constexpr int utf8_seqlen (int c)
+		{
+			if (c < 0x80)
+				return 0;
+			else if (c < 0xC2)
+				return -1;
+			else if (c < 0xE0)
+				return 1;
+			else if (c < 0xF0)
+				return 2;
+			else if (c < 0xF5)
+				return 3;
+
+			return -1;
+		}
+
+		constexpr const char* utf8_findinvalid (const char* start, const char* end)
+		{
+			const char* it= start;
+			while (it != end)
+			{
+				int c= (unsigned char) *it;
+				int n= utf8_seqlen (c);
+				int lo= 0x80, hi= 0xBF;
+				int i;
+
+				if (n == 0)
+				{
+					it++;
+					continue;
+				}
+
+				if (n < 0 || end - it <= n)
+					return it;
+
+				switch (c)
+				{
+					case 0xE0:	lo= 0xA0;	break;
+					case 0xED:	hi= 0x9F;	break;
+					case 0xF0:	lo= 0x90;	break;
+					case 0xF4:	hi= 0x8F;	break;
+				}
+
+				if ((unsigned char) it[1] < lo || hi < (unsigned char) it[1])
+					return it;
+
+				for (i= 2; i <= n; i++)
+				{
+					if (((unsigned char) it[i] & 0xC0) != 0x80)
+						return it;
+				}
+
+				it+= n + 1;
+			}
+
+			return end;
+		}
+
+		constexpr const char* utf8_findtail (const char* start, const char* end)
+		{
+			const char* it;
+			for (it= end; it != start && end - it < 4; )
+			{
+				int n, c= (unsigned char) *--it;
+				if ((c & 0xC0) == 0x80)
+					continue;
+
+				n= utf8_seqlen (c);
+				return (0 < n && end - it <= n) ? it : end;
+			}
+
+			return end;
+		}
+
+		/* MARK: State */
+
+		struct args_t
+		{
+			const char* buffer;
+			unsigned bufferlen;
+			sxmltok_t* tokens;	/* NULL to only count the tokens */
+			unsigned num_tokens;
+			bool skip;
+		};
+
+		constexpr const char* buffer_fromoffset (const args_t& args, unsigned i)	{ return args.buffer + i; }
+		constexpr unsigned buffer_tooffset (const args_t& args, const char* ptr)	{ return (unsigned) (ptr - args.buffer); }
+		constexpr const char* buffer_getend (const args_t& args)	{ return args.buffer + args.bufferlen; }
+
+		constexpr bool state_skips (const sxml_t& state, sxmltype_t type)
+		{
+			return (state.skipmask & SXML_TYPEMASK (type)) != 0;
+		}
+
+		constexpr sxmltok_t* state_pushtoken (sxml_t& state, args_t& args, sxmltype_t type, const char* start, const char* end)
+		{
+			switch (type)
+			{
+				case SXML_STARTTAG:	state.taglevel++;	break;
+				case SXML_ENDTAG:	state.taglevel--;	break;
+				default:	break;
+			}
+
+			if (args.skip)
+				return nullptr;
+
+			unsigned i= state.ntokens++;
+			if (args.num_tokens < state.ntokens || args.tokens == nullptr)
+				return nullptr;
+
+			sxmltok_t* token= &args.tokens[i];
+			token->type= (unsigned char) type;
+			token->flags= 0;
+			token->size= 0;
+			token->startpos= buffer_tooffset (args, start);
+			token->endpos= buffer_tooffset (args, end);
+			return token;
+		}
+
+		constexpr sxmlerr_t state_setpos (sxml_t& state, const args_t& args, const char* ptr)
+		{
+			state.bufferpos= buffer_tooffset (args, ptr);
+			return (state.ntokens <= args.num_tokens) ? SXML_SUCCESS : SXML_ERROR_TOKENSFULL;
+		}
+
+		constexpr sxmlerr_t state_commit (sxml_t& dest, sxml_t& src, const args_t& args)
+		{
+			const char* start= buffer_fromoffset (args, dest.bufferpos);
+			const char* end= buffer_fromoffset (args, src.bufferpos);
+
+			if (dest.flags & SXML_FLAG_UTF8)
+			{
+				const char* invalid= utf8_findinvalid (start, end);
+				if (invalid != end)
+				{
+					dest.errorpos= buffer_tooffset (args, invalid);
+					return SXML_ERROR_XMLINVALID;
+				}
+			}
+
+			if (dest.flags & SXML_FLAG_LINES)
+			{
+				src.lineno= dest.lineno;
+				src.colno= dest.colno;
+				for (const char* it= start; it != end; it++)
+				{
+					src.colno++;
+					if (*it == '\n')
+					{
+						src.lineno++;
+						src.colno= 1;
+					}
+				}
+			}
+
+			dest= src;
+			return SXML_SUCCESS;
+		}
+
+		/* MARK: Parse */
+
+		constexpr unsigned ENTITY_MAXLEN= 8;	/* &#x03A3; */
+		constexpr unsigned TAG_MINSIZE= 3;
+
+		constexpr const char* str_limit (const char* it, const char* end, unsigned n)
+		{
+			return ((unsigned) (end - it) < n) ? end : it + n;
+		}
+
+		constexpr unsigned TAG_LEN (const char* str)
+		{
+			unsigned n= 0;
+			while (str[n] != '\0')
+				n++;
+
+			return n;
+		}
+
+		constexpr sxmlerr_t parse_charrun (sxml_t& state, args_t& args, const char* end)
+		{
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* it= start;
+			bool escaped= false;
+
+			for (;;)
+			{
+				const char* ampr= str_findchr (it, end, '&');
+				if (ampr == end)
+				{
+					it= end;
+					break;
+				}
+
+				const char* limit= str_limit (ampr, end, ENTITY_MAXLEN);
+				const char* colon= str_findchr (ampr, limit, ';');
+				if (colon == limit)
+				{
+					if (limit != end)
+						return SXML_ERROR_XMLINVALID;
+
+					it= ampr;
+					break;
+				}
+
+				escaped= true;
+				it= colon + 1;
+			}
+
+			if (it == buffer_getend (args) && (state.flags & SXML_FLAG_UTF8))
+				it= utf8_findtail (start, it);
+
+			if (it == start)
+				return SXML_ERROR_BUFFERDRY;
+
+			sxmltok_t* token= state_pushtoken (state, args, SXML_CHARACTER, start, it);
+			if (token != nullptr && escaped)
+				token->flags= SXML_TOKEN_ESCAPED;
+
+			return state_setpos (state, args, it);
+		}
+
+		constexpr sxmlerr_t parse_characters (sxml_t& state, args_t& args, const char* end)
+		{
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+
+			if (state.flags & SXML_FLAG_COALESCE)
+				return parse_charrun (state, args, end);
+
+			const char* ampr= str_findchr (start, end, '&');
+
+			if (ampr == buffer_getend (args) && (state.flags & SXML_FLAG_UTF8))
+			{
+				ampr= utf8_findtail (start, ampr);
+				if (ampr == start)
+					return SXML_ERROR_BUFFERDRY;
+
+				end= ampr;
+			}
+
+			if (ampr != start)
+				state_pushtoken (state, args, SXML_CHARACTER, start, ampr);
+
+			if (ampr == end)
+				return state_setpos (state, args, ampr);
+
+			const char* limit= str_limit (ampr, end, ENTITY_MAXLEN);
+			const char* colon= str_findchr (ampr, limit, ';');
+			if (colon == limit)
+				return (limit == end) ? SXML_ERROR_BUFFERDRY : SXML_ERROR_XMLINVALID;
+
+			start= colon + 1;
+			state_pushtoken (state, args, SXML_CHARACTER, ampr, start);
+			return state_setpos (state, args, start);
+		}
+
+		constexpr sxmlerr_t parse_attrvalue (sxml_t& state, args_t& args, const char* end)
+		{
+			while (buffer_fromoffset (args, state.bufferpos) != end)
+			{
+				sxmlerr_t err= parse_characters (state, args, end);
+				if (err != SXML_SUCCESS)
+					return err;
+			}
+
+			return SXML_SUCCESS;
+		}
+
+		constexpr sxmlerr_t parse_attributes (sxml_t& state, args_t& args)
+		{
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+			const char* name= str_ltrim (start, end);
+			unsigned ntokens= state.ntokens;
+
+			while (name != end && ISALPHA (*name))
+			{
+				const char* eq= str_findchr (name, end, '=');
+				if (eq == end)
+					return SXML_ERROR_BUFFERDRY;
+
+				state_pushtoken (state, args, SXML_CDATA, name, str_rtrim (name, eq));
+
+				const char* quot= str_ltrim (eq + 1, end);
+				if (quot == end)
+					return SXML_ERROR_BUFFERDRY;
+				else if (*quot != '\'' && *quot != '"')
+					return SXML_ERROR_XMLINVALID;
+
+				const char* value= quot + 1;
+				quot= str_findchr (value, end, *quot);
+				if (quot == end)
+					return SXML_ERROR_BUFFERDRY;
+
+				state_setpos (state, args, value);
+				sxmlerr_t err= parse_attrvalue (state, args, quot);
+				if (err != SXML_SUCCESS)
+					return err;
+
+				name= str_ltrim (quot + 1, end);
+			}
+
+			if (!args.skip && args.tokens != nullptr && ntokens <= args.num_tokens)
+				args.tokens[ntokens - 1].size= (unsigned short) (state.ntokens - ntokens);
+
+			return state_setpos (state, args, name);
+		}
+
+		constexpr sxmlerr_t parse_comment (sxml_t& state, args_t& args)
+		{
+			constexpr const char* STARTTAG= "<!--";
+			constexpr const char* ENDTAG= "-->";
+
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+			if ((unsigned) (end - start) < TAG_LEN (STARTTAG))
+				return SXML_ERROR_BUFFERDRY;
+
+			if (!str_startswith (start, end, STARTTAG))
+				return SXML_ERROR_XMLINVALID;
+
+			start+= TAG_LEN (STARTTAG);
+			const char* dash= str_findstr (start, end, ENDTAG);
+			if (dash == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			args.skip= state_skips (state, SXML_COMMENT);
+			state_pushtoken (state, args, SXML_COMMENT, start, dash);
+			return state_setpos (state, args, dash + TAG_LEN (ENDTAG));
+		}
+
+		constexpr sxmlerr_t parse_instruction (sxml_t& state, args_t& args)
+		{
+			constexpr const char* STARTTAG= "<?";
+			constexpr const char* ENDTAG= "?>";
+
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+
+			if (!str_startswith (start, end, STARTTAG))
+				return SXML_ERROR_XMLINVALID;
+
+			start+= TAG_LEN (STARTTAG);
+			const char* space= str_find_notalnum (start, end);
+			if (space == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			args.skip= state_skips (state, SXML_INSTRUCTION);
+			state_pushtoken (state, args, SXML_INSTRUCTION, start, space);
+
+			state_setpos (state, args, space);
+			sxmlerr_t err= parse_attributes (state, args);
+			if (err != SXML_SUCCESS)
+				return err;
+
+			const char* quest= buffer_fromoffset (args, state.bufferpos);
+			if ((unsigned) (end - quest) < TAG_LEN (ENDTAG))
+				return SXML_ERROR_BUFFERDRY;
+
+			if (!str_startswith (quest, end, ENDTAG))
+				return SXML_ERROR_XMLINVALID;
+
+			return state_setpos (state, args, quest + TAG_LEN (ENDTAG));
+		}
+
+		constexpr sxmlerr_t parse_doctype (sxml_t& state, args_t& args)
+		{
+			constexpr const char* STARTTAG= "<!DOCTYPE";
+			constexpr const char* ENDTAG= "]>";
+
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+			if ((unsigned) (end - start) < TAG_LEN (STARTTAG))
+				return SXML_ERROR_BUFFERDRY;
+
+			if (!str_startswith (start, end, STARTTAG))
+				return SXML_ERROR_BUFFERDRY;
+
+			start+= TAG_LEN (STARTTAG);
+			const char* bracket= str_findstr (start, end, ENDTAG);
+			if (bracket == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			args.skip= state_skips (state, SXML_DOCTYPE);
+			state_pushtoken (state, args, SXML_DOCTYPE, start, bracket);
+			return state_setpos (state, args, bracket + TAG_LEN (ENDTAG));
+		}
+
+		constexpr sxmlerr_t parse_start (sxml_t& state, args_t& args)
+		{
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+
+			if (!(start[0] == '<' && ISALPHA (start[1])))
+				return SXML_ERROR_XMLINVALID;
+
+			const char* name= start + 1;
+			const char* space= str_find_notalnum (name, end);
+			if (space == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			args.skip= state_skips (state, SXML_STARTTAG);
+			state_pushtoken (state, args, SXML_STARTTAG, name, space);
+
+			state_setpos (state, args, space);
+			sxmlerr_t err= parse_attributes (state, args);
+			if (err != SXML_SUCCESS)
+				return err;
+
+			const char* gt= buffer_fromoffset (args, state.bufferpos);
+			if (gt != end && *gt == '/')
+			{
+				state_pushtoken (state, args, SXML_ENDTAG, name, space);
+				gt++;
+			}
+
+			if (gt == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			if (*gt != '>')
+				return SXML_ERROR_XMLINVALID;
+
+			return state_setpos (state, args, gt + 1);
+		}
+
+		constexpr sxmlerr_t parse_end (sxml_t& state, args_t& args)
+		{
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+
+			if (!(str_startswith (start, end, "</") && ISALPHA (start[2])))
+				return SXML_ERROR_XMLINVALID;
+
+			start+= 2;
+			const char* gt= str_findchr (start, end, '>');
+			if (gt == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			const char* space= str_find_notalnum (start, gt);
+			if (str_ltrim (space, gt) != gt)
+				return SXML_ERROR_XMLINVALID;
+
+			args.skip= state_skips (state, SXML_ENDTAG);
+			state_pushtoken (state, args, SXML_ENDTAG, start, space);
+			return state_setpos (state, args, gt + 1);
+		}
+
+		constexpr sxmlerr_t parse_cdata (sxml_t& state, args_t& args)
+		{
+			constexpr const char* STARTTAG= "<![CDATA[";
+			constexpr const char* ENDTAG= "]]>";
+
+			const char* start= buffer_fromoffset (args, state.bufferpos);
+			const char* end= buffer_getend (args);
+			if ((unsigned) (end - start) < TAG_LEN (STARTTAG))
+				return SXML_ERROR_BUFFERDRY;
+
+			if (!str_startswith (start, end, STARTTAG))
+				return SXML_ERROR_XMLINVALID;
+
+			start+= TAG_LEN (STARTTAG);
+			const char* bracket= str_findstr (start, end, ENDTAG);
+			if (bracket == end)
+				return SXML_ERROR_BUFFERDRY;
+
+			args.skip= state_skips (state, SXML_CDATA);
+			state_pushtoken (state, args, SXML_CDATA, start, bracket);
+			return state_setpos (state, args, bracket + TAG_LEN (ENDTAG));
+		}
+
+		/* MARK: Document */
+
+		constexpr sxmlerr_t state_endrecord (sxml_t& state, args_t& args)
+		{
+			const char* pos= buffer_fromoffset (args, state.bufferpos);
+			if (!(state.flags & SXML_FLAG_STREAM))
+				return SXML_SUCCESS;
+
+			args.skip= state_skips (state, SXML_RECORD);
+			state_pushtoken (state, args, SXML_RECORD, pos, pos);
+			return state_setpos (state, args, pos);
+		}
+
+		constexpr sxmlerr_t parse_document (sxml_t& state, args_t& args)
+		{
+			sxml_t temp= state;
+			const char* end= buffer_getend (args);
+
+			for (;;)
+			{
+				bool rootfound= (0 < temp.taglevel);
+
+				while (!rootfound)
+				{
+					const char* lt= str_ltrim (buffer_fromoffset (args, temp.bufferpos), end);
+					state_setpos (temp, args, lt);
+					sxmlerr_t err= state_commit (state, temp, args);
+					if (err != SXML_SUCCESS)
+						return err;
+
+					if ((unsigned) (end - lt) < TAG_MINSIZE)
+						return SXML_ERROR_BUFFERDRY;
+
+					if (*lt != '<')
+						return SXML_ERROR_XMLINVALID;
+
+					switch (lt[1])
+					{
+					case '?':	err= parse_instruction (temp, args);	break;
+					case '!':	err= (lt[2] == '-') ? parse_comment (temp, args) : parse_doctype (temp, args);	break;
+					default:	err= parse_start (temp, args);	rootfound= true;	break;
+					}
+
+					if (err != SXML_SUCCESS)
+						return err;
+
+					if (rootfound && temp.taglevel == 0)
+					{
+						err= state_endrecord (temp, args);
+						if (err != SXML_SUCCESS)
+							return err;
+					}
+
+					err= state_commit (state, temp, args);
+					if (err != SXML_SUCCESS)
+						return err;
+				}
+
+				while (temp.taglevel != 0)
+				{
+					const char* start= buffer_fromoffset (args, temp.bufferpos);
+					const char* lt= str_findchr (start, end, '<');
+
+					if ((temp.flags & SXML_FLAG_NOSPACE) && !temp.textrun && start != lt && str_ltrim (start, lt) == lt)
+					{
+						if (lt == end)
+							return SXML_ERROR_BUFFERDRY;
+
+						state_setpos (temp, args, lt);
+					}
+
+					args.skip= state_skips (temp, SXML_CHARACTER);
+
+					while (buffer_fromoffset (args, temp.bufferpos) != lt)
+					{
+						sxmlerr_t err= parse_characters (temp, args, lt);
+						if (err != SXML_SUCCESS)
+							return err;
+
+						temp.textrun= 1;
+						err= state_commit (state, temp, args);
+						if (err != SXML_SUCCESS)
+							return err;
+					}
+
+					if ((unsigned) (end - lt) < TAG_MINSIZE)
+						return SXML_ERROR_BUFFERDRY;
+
+					sxmlerr_t err= SXML_SUCCESS;
+					switch (lt[1])
+					{
+					case '?':	err= parse_instruction (temp, args);	break;
+					case '/':	err= parse_end (temp, args);	break;
+					case '!':	err= (lt[2] == '-') ? parse_comment (temp, args) : parse_cdata (temp, args);	break;
+					default:	err= parse_start (temp, args);	break;
+					}
+
+					if (err != SXML_SUCCESS)
+						return err;
+
+					temp.textrun= 0;
+					if (temp.taglevel == 0)
+					{
+						err= state_endrecord (temp, args);
+						if (err != SXML_SUCCESS)
+							return err;
+					}
+
+					err= state_commit (state, temp, args);
+					if (err != SXML_SUCCESS)
+						return err;
+				}
+
+				if (!(temp.flags & SXML_FLAG_STREAM))
+					return SXML_SUCCESS;
+			}
+		}
+
+		/* A whole document is parsed at once - running out of input means it is incomplete */
+		constexpr sxmlerr_t parse_whole (sxml_t& state, args_t& args)
+		{
+			sxmlerr_t err= parse_document (state, args);
+			if (err == SXML_ERROR_BUFFERDRY && (state.flags & SXML_FLAG_STREAM) && state.taglevel == 0 && state.bufferpos == args.bufferlen)
+				return SXML_SUCCESS;
+
+			return (err == SXML_ERROR_BUFFERDRY) ? SXML_ERROR_XMLINVALID : err;
+		}
+	}
+
+	/* Same as sxml_init() and sxml_parse() */
+
+	constexpr void init (sxml_t& parser)
+	{
+		parser.bufferpos= 0;
+		parser.ntokens= 0;
+		parser.taglevel= 0;
+		parser.textrun= 0;
+		parser.flags= 0;
+		parser.errorpos= 0;
+		parser.skipmask= 0;
+		parser.lineno= 1;
+		parser.colno= 1;
+		parser.bytebudget= 0;
+		parser.tokenbudget= 0;
+	}
+
+	constexpr sxmlerr_t parse (sxml_t& parser, const char* buffer, unsigned bufferlen, sxmltok_t* tokens, unsigned num_tokens)
+	{
+		detail::args_t args= {buffer, bufferlen, tokens, num_tokens, false};
+		return detail::parse_document (parser, args);
+	}
+
+	/* String literal usable as a template argument */
+	template <std::size_t N>
+	struct fixed_string
+	{
+		char data[N];
+
+		constexpr fixed_string (const char (&str)[N])
+		{
+			for (std::size_t i= 0; i < N; i++)
+				data[i]= str[i];
+		}
+
+		constexpr unsigned size () const	{ return (unsigned) (N - 1); }
+	};
+
+	/* Embedded XML together with its token table */
+	template <std::size_t NTokens>
+	struct document
+	{
+		const char* buffer;
+		unsigned bufferlen;
+		std::array<sxmltok_t, NTokens> tokens;
+	};
+
+	namespace detail
+	{
+		struct probe_t
+		{
+			sxmlerr_t err;
+			unsigned ntokens;
+			unsigned lineno;
+			unsigned colno;
+		};
+
+		/* First pass only counts the tokens - and finds where the XML is malformed */
+		constexpr probe_t probe (const char* buffer, unsigned bufferlen, unsigned flags, unsigned skipmask)
+		{
+			sxml_t parser= {};
+			init (parser);
+			parser.flags= flags | SXML_FLAG_LINES;
+			parser.skipmask= skipmask;
+
+			args_t args= {buffer, bufferlen, nullptr, ~0u, false};
+			sxmlerr_t err= parse_whole (parser, args);
+
+			/* Point at the bad utf-8 sequence instead of the start of the construct holding it */
+			if (err == SXML_ERROR_XMLINVALID && (flags & SXML_FLAG_UTF8) && parser.bufferpos < parser.errorpos)
+			{
+				for (const char* it= buffer + parser.bufferpos; it != buffer + parser.errorpos; it++)
+					parser.colno= (*it == '\n') ? (parser.lineno++, 1) : parser.colno + 1;
+			}
+
+			return probe_t {err, parser.ntokens, parser.lineno, parser.colno};
+		}
+
+		/* Not constexpr - calling it stops the compiler with the position of the error in its template arguments */
+		template <unsigned Line, unsigned Column>
+		void malformed_xml ()
+		{
+			static_assert (Line == 0 && Column == 0, "Embedded XML is malformed - see Line and Column of this instantiation");
+		}
+	}
+
+	template <fixed_string Xml, unsigned Flags= 0, unsigned SkipMask= 0>
+	consteval auto compile ()
+	{
+		constexpr detail::probe_t probe= detail::probe (Xml.data, Xml.size (), Flags, SkipMask);
+
+		if constexpr (probe.err != SXML_SUCCESS)
+		{
+			detail::malformed_xml<probe.lineno, probe.colno> ();
+			return document<0> {};
+		}
+		else
+		{
+			document<probe.ntokens> doc= {Xml.data, Xml.size (), {}};
+
+			sxml_t parser= {};
+			init (parser);
+			parser.flags= Flags;
+			parser.skipmask= SkipMask;
+
+			detail::args_t args= {Xml.data, Xml.size (), doc.tokens.data (), probe.ntokens, false};
+			detail::parse_whole (parser, args);
+			return doc;
+		}
+	}
+
+	template <fixed_string Xml, unsigned Flags= 0, unsigned SkipMask= 0>
+	inline constexpr auto embed= compile<Xml, Flags, SkipMask> ();
+}
+
+#endif /* _SXML_CONSTEXPR_HPP_INCLUDED */
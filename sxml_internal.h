@@ -0,0 +1,35 @@
+#ifndef _SXML_INTERNAL_H_INCLUDED
+#define _SXML_INTERNAL_H_INCLUDED
+
+/*
+ --- SXML internals ---
+ Shared by sxml.c and the extras - not part of the API, so don't include it from your own code.
+*/
+
+typedef unsigned UINT;
+typedef int BOOL;
+#define FALSE	0
+#define TRUE	(!FALSE)
+
+/*
+ MARK: Word
+ Text is scanned a machine word at a time where it pays off.
+*/
+
+typedef unsigned long WORD;
+#define WORD_ONES		((WORD) -1 / 0xFF)
+#define WORD_HIGHBITS	(WORD_ONES * 0x80)
+
+/* Nonzero if any byte of 'w' is less than 'n' (at most 0x80) */
+#define WORD_HASLESS(w,n)	(((w) - WORD_ONES * (n)) & ~(w) & WORD_HIGHBITS)
+#define WORD_HASBYTE(w,c)	WORD_HASLESS ((w) ^ (WORD_ONES * (c)), 1)
+
+/*
+ MARK: Lines
+ Defined in sxml.c, so SXML_FLAG_LINES and the extras count lines the same way.
+*/
+
+/* Returns number of newlines in range - 'linestart' is set to just after the last newline, or 'start' if there is none */
+UINT sxml_countlines (const char* start, const char* end, const char** linestart);
+
+#endif /* _SXML_INTERNAL_H_INCLUDED */
@@ -0,0 +1,375 @@
+#include "sxml_json.h"
+#include "sxml_internal.h"
+
+#include <string.h>	/* memcpy, memchr, memset, memcmp, strlen */
+#include <assert.h>	/* assert */
+
+void sxml_json_init (sxmljson_t* json)
+{
+	json->namekey= "#name";
+	json->attrprefix= "@";
+	json->childkey= "#children";
+	json->textkey= NULL;
+	json->recorddepth= 0;
+	json->write= NULL;
+	json->user= NULL;
+
+	json->depth= 0;
+	json->comma= FALSE;
+	json->intext= FALSE;
+	memset (json->haschildren, 0, sizeof (json->haschildren));
+}
+
+/* MARK: Output */
+
+static void json_putn (sxmljson_t* json, const char* data, UINT len)
+{
+	if (len != 0)
+		json->write (json->user, data, len);
+}
+
+static void json_puts (sxmljson_t* json, const char* str)
+{
+	json_putn (json, str, (UINT) strlen (str));
+}
+
+static void json_putc (sxmljson_t* json, char c)
+{
+	json->write (json->user, &c, 1);
+}
+
+/* MARK: Escaping */
+
+/*
+ Text is scanned a word at a time for bytes that need escaping - or a reference to decode.
+ Everything in between is written straight from the input buffer.
+*/
+static BOOL json_isspecial (char c, BOOL decode)
+{
+	return (unsigned char) c < 0x20 || c == '"' || c == '\\' || (decode && c == '&');
+}
+
+static const char* str_findspecial (const char* start, const char* end, BOOL decode)
+{
+	const char* it;
+
+	for (it= start; (size_t) (end - it) >= sizeof (WORD); it+= sizeof (WORD))
+	{
+		WORD w, found;
+		memcpy (&w, it, sizeof (WORD));
+
+		found= WORD_HASLESS (w, 0x20) | WORD_HASBYTE (w, '"') | WORD_HASBYTE (w, '\\');
+		if (decode)
+			found|= WORD_HASBYTE (w, '&');
+
+		if (found)
+			break;
+	}
+
+	for (; it < end; it++)
+	{
+		if (json_isspecial (*it, decode))
+			return it;
+	}
+
+	return end;
+}
+
+static void json_putescaped (sxmljson_t* json, char c)
+{
+	static const char hex[]= "0123456789abcdef";
+	char esc[6]= {'\\', 'u', '0', '0', 0, 0};
+
+	switch (c)
+	{
+		case '"':	json_putn (json, "\\\"", 2);	return;
+		case '\\':	json_putn (json, "\\\\", 2);	return;
+		case '\n':	json_putn (json, "\\n", 2);	return;
+		case '\r':	json_putn (json, "\\r", 2);	return;
+		case '\t':	json_putn (json, "\\t", 2);	return;
+		default:	break;
+	}
+
+	esc[4]= hex[(unsigned char) c >> 4];
+	esc[5]= hex[(unsigned char) c & 0xF];
+	json_putn (json, esc, sizeof (esc));
+}
+
+static void json_putcodepoint (sxmljson_t* json, unsigned long cp)
+{
+	char utf8[4];
+
+	/* Not a valid XML character - write the replacement character instead */
+	if (cp == 0 || (0xD800 <= cp && cp <= 0xDFFF) || 0x10FFFF < cp)
+		cp= 0xFFFD;
+
+	if (cp < 0x80)
+	{
+		char c= (char) cp;
+		if (json_isspecial (c, FALSE))
+			json_putescaped (json, c);
+		else
+			json_putc (json, c);
+	}
+	else if (cp < 0x800)
+	{
+		utf8[0]= (char) (0xC0 | (cp >> 6));
+		utf8[1]= (char) (0x80 | (cp & 0x3F));
+		json_putn (json, utf8, 2);
+	}
+	else if (cp < 0x10000)
+	{
+		utf8[0]= (char) (0xE0 | (cp >> 12));
+		utf8[1]= (char) (0x80 | ((cp >> 6) & 0x3F));
+		utf8[2]= (char) (0x80 | (cp & 0x3F));
+		json_putn (json, utf8, 3);
+	}
+	else
+	{
+		utf8[0]= (char) (0xF0 | (cp >> 18));
+		utf8[1]= (char) (0x80 | ((cp >> 12) & 0x3F));
+		utf8[2]= (char) (0x80 | ((cp >> 6) & 0x3F));
+		utf8[3]= (char) (0x80 | (cp & 0x3F));
+		json_putn (json, utf8, 4);
+	}
+}
+
+/* Decodes the reference starting at 'start' and returns the position following it */
+static const char* json_putreference (sxmljson_t* json, const char* start, const char* end)
+{
+	const char* semi= (const char*) memchr (start, ';', end - start);
+	const char* name= start + 1;
+	UINT namelen;
+
+	assert (*start == '&');
+	if (semi == NULL)
+	{
+		/* The parser only hands out complete references - write whatever this is as it is */
+		json_putc (json, '&');
+		return start + 1;
+	}
+
+	namelen= (UINT) (semi - name);
+	if (namelen != 0 && *name == '#')
+	{
+		unsigned long cp= 0;
+		BOOL ishex= (1 < namelen && (name[1] == 'x' || name[1] == 'X'));
+		const char* it;
+
+		for (it= name + (ishex ? 2 : 1); it < semi && cp <= 0x10FFFF; it++)
+		{
+			char c= *it;
+			if ('0' <= c && c <= '9')
+				cp= cp * (ishex ? 16 : 10) + (c - '0');
+			else if (ishex && 'a' <= (c | 0x20) && (c | 0x20) <= 'f')
+				cp= cp * 16 + ((c | 0x20) - 'a' + 10);
+			else
+				break;
+		}
+
+		json_putcodepoint (json, (it == semi) ? cp : 0);
+	}
+	else if (namelen == 3 && memcmp (name, "amp", 3) == 0)	json_putc (json, '&');
+	else if (namelen == 2 && memcmp (name, "lt", 2) == 0)	json_putc (json, '<');
+	else if (namelen == 2 && memcmp (name, "gt", 2) == 0)	json_putc (json, '>');
+	else if (namelen == 4 && memcmp (name, "quot", 4) == 0)	json_putescaped (json, '"');
+	else if (namelen == 4 && memcmp (name, "apos", 4) == 0)	json_putc (json, '\'');
+	else
+	{
+		/* Entity declared in the DTD - left as it is */
+		json_putn (json, start, (UINT) (semi + 1 - start));
+	}
+
+	return semi + 1;
+}
+
+/* Writes the text of 'token' as the contents of a JSON string - references are only decoded if 'decode' is set */
+static void json_puttext (sxmljson_t* json, const char* buffer, const sxmltok_t* token, BOOL decode)
+{
+	const char* it= buffer + token->startpos;
+	const char* end= buffer + token->endpos;
+
+	while (it < end)
+	{
+		const char* special= str_findspecial (it, end, decode);
+		json_putn (json, it, (UINT) (special - it));
+		if (special == end)
+			break;
+
+		if (*special == '&')
+		{
+			it= json_putreference (json, special, end);
+		}
+		else
+		{
+			json_putescaped (json, *special);
+			it= special + 1;
+		}
+	}
+}
+
+/* MARK: Structure */
+
+#define DEPTH_GET(json,d)	((json)->haschildren[(d) >> 3] & (1u << ((d) & 7)))
+#define DEPTH_SET(json,d)	((json)->haschildren[(d) >> 3]|= (unsigned char) (1u << ((d) & 7)))
+#define DEPTH_CLEAR(json,d)	((json)->haschildren[(d) >> 3]&= (unsigned char) ~(1u << ((d) & 7)))
+
+static void json_closetext (sxmljson_t* json)
+{
+	if (!json->intext)
+		return;
+
+	json_puts (json, (json->textkey != NULL) ? "\"}" : "\"");
+	json->intext= FALSE;
+	json->comma= TRUE;
+}
+
+/* Prepares for writing an item to the child array of the current element - the array is opened with its first item */
+static void json_beginchild (sxmljson_t* json)
+{
+	UINT d= json->depth - 1;
+	if (!DEPTH_GET (json, d))
+	{
+		json_puts (json, ",\"");
+		json_puts (json, json->childkey);
+		json_puts (json, "\":[");
+		DEPTH_SET (json, d);
+		json->comma= FALSE;
+	}
+
+	if (json->comma)
+		json_putc (json, ',');
+}
+
+static void json_putkey (sxmljson_t* json, const char* prefix, const char* buffer, const sxmltok_t* token)
+{
+	json_putc (json, '"');
+	json_puts (json, prefix);
+	json_puttext (json, buffer, token, FALSE);
+	json_puts (json, "\":\"");
+}
+
+static BOOL json_startelement (sxmljson_t* json, const char* buffer, const sxmltok_t* token)
+{
+	UINT d= json->depth;
+	UINT i;
+
+	if (SXML_JSON_MAXDEPTH <= d)
+		return FALSE;
+
+	if (json->recorddepth <= d)
+	{
+		json_closetext (json);
+		if (json->recorddepth < d)
+			json_beginchild (json);
+
+		json_putc (json, '{');
+		json_putc (json, '"');
+		json_puts (json, json->namekey);
+		json_puts (json, "\":\"");
+		json_puttext (json, buffer, token, FALSE);
+		json_putc (json, '"');
+
+		/* Attribute key followed by the tokens of its value */
+		for (i= 1; i <= token->size; i++)
+		{
+			json_putc (json, ',');
+			json_putkey (json, json->attrprefix, buffer, token + i);
+			while (i < token->size && token[i + 1].type == SXML_CHARACTER)
+				json_puttext (json, buffer, token + ++i, TRUE);
+
+			json_putc (json, '"');
+		}
+	}
+
+	DEPTH_CLEAR (json, d);
+	json->depth= d + 1;
+	json->comma= FALSE;
+	return TRUE;
+}
+
+static void json_endelement (sxmljson_t* json)
+{
+	UINT d;
+
+	assert (0 < json->depth);
+	d= --json->depth;
+	if (d < json->recorddepth)
+		return;
+
+	json_closetext (json);
+	if (DEPTH_GET (json, d))
+		json_putc (json, ']');
+
+	json_putc (json, '}');
+
+	/* Each record is a document of its own */
+	if (d == json->recorddepth)
+	{
+		json_putc (json, '\n');
+		json->comma= FALSE;
+	}
+	else
+	{
+		json->comma= TRUE;
+	}
+}
+
+static void json_text (sxmljson_t* json, const char* buffer, const sxmltok_t* token)
+{
+	/* Only text inside a record is written */
+	if (json->depth <= json->recorddepth)
+		return;
+
+	/* Consecutive tokens - even around a comment - continue the same string */
+	if (!json->intext)
+	{
+		json_beginchild (json);
+		if (json->textkey != NULL)
+		{
+			json_puts (json, "{\"");
+			json_puts (json, json->textkey);
+			json_puts (json, "\":");
+		}
+
+		json_putc (json, '"');
+		json->intext= TRUE;
+	}
+
+	json_puttext (json, buffer, token, token->type == SXML_CHARACTER);
+}
+
+sxmlerr_t sxml_json_write (sxmljson_t* json, const char* buffer, const sxmltok_t tokens[], UINT ntokens)
+{
+	UINT i;
+
+	assert (json->write != NULL);
+	for (i= 0; i < ntokens; i++)
+	{
+		const sxmltok_t* token= tokens + i;
+		switch (token->type)
+		{
+			case SXML_STARTTAG:
+				if (!json_startelement (json, buffer, token))
+					return SXML_ERROR_XMLINVALID;
+				break;
+
+			case SXML_ENDTAG:
+				json_endelement (json);
+				break;
+
+			case SXML_CHARACTER:
+			case SXML_CDATA:
+				json_text (json, buffer, token);
+				break;
+
+			/* Instructions, DTD data and comments have no place in the JSON output */
+			default:
+				break;
+		}
+
+		i+= token->size;
+	}
+
+	return SXML_SUCCESS;
+}
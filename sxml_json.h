@@ -0,0 +1,68 @@
+#ifndef _SXML_JSON_H_INCLUDED
+#define _SXML_JSON_H_INCLUDED
+
+#include "sxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ --- SXML JSON ---
+ Optional streaming transcoder from SXML tokens to JSON.
+ Feed it the tokens after each call to sxml_parse() - the same way sxml_test.c pretty prints them.
+ It uses a fixed amount of memory no matter how large the document is.
+
+ Every element is written as an object:
+
+ <item id='7'>Hello <b>there</b></item>
+ {"#name":"item","@id":"7","#children":["Hello ",{"#name":"b","#children":["there"]}]}
+
+ Character references are decoded and the text is escaped for JSON.
+ Comments, instructions and DTD data are dropped.
+
+ As nothing is known about the rest of the element when a child is written, repeated children can't be merged into arrays by name.
+ Instead all child elements and text are listed in order in one array - it is left out for elements without any content.
+ Set SXML_FLAG_NOSPACE on the parser if you don't want whitespace between elements in the output.
+*/
+
+#define SXML_JSON_MAXDEPTH	256	/* Deeper nesting is reported as SXML_ERROR_XMLINVALID */
+
+typedef struct sxmljson_t sxmljson_t;
+struct sxmljson_t
+{
+	/*
+	 Mapping rules - sxml_json_init() sets up the defaults shown above.
+	 'textkey' writes text as {"#text":"Hello "} instead of a plain string if set.
+	*/
+	const char *namekey;
+	const char *attrprefix;
+	const char *childkey;
+	const char *textkey;
+
+	/*
+	 Elements above 'recorddepth' are left out and each element at that depth is written as a JSON document on its own line.
+	 The default of zero writes each root element as one document - use it together with SXML_FLAG_STREAM for newline delimited JSON.
+	 Set it to 1 to write each child of the root element on its own line instead - the usual way to turn a large feed into newline delimited JSON.
+	*/
+	unsigned recorddepth;
+
+	/* Output - called with each piece of JSON text */
+	void (*write)(void *user, const char *data, unsigned len);
+	void *user;
+
+	/* Used internally */
+	unsigned depth;
+	int comma;
+	int intext;
+	unsigned char haschildren[SXML_JSON_MAXDEPTH / 8];
+};
+
+void sxml_json_init(sxmljson_t *json);
+sxmlerr_t sxml_json_write(sxmljson_t *json, const char *buffer, const sxmltok_t *tokens, unsigned ntokens);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SXML_JSON_H_INCLUDED */
@@ -0,0 +1,41 @@
+#include "sxml_lines.h"
+#include "sxml_internal.h"
+
+#include <assert.h>	/* assert */
+
+#define MIN(a,b)	((a) < (b) ? (a) : (b))
+
+/* MARK: Index */
+
+void sxml_index_lines (const char* buffer, UINT bufferlen, UINT stride, UINT* lines)
+{
+	UINT i, n= 0;
+	assert (0 < stride);
+
+	for (i= 0; i <= bufferlen / stride; i++)
+	{
+		const char* linestart;
+		const char* it= buffer + i * stride;
+
+		lines[i]= n;
+		n+= sxml_countlines (it, it + MIN (stride, bufferlen - i * stride), &linestart);
+	}
+}
+
+void sxml_find_line (const char* buffer, UINT stride, const UINT* lines, UINT offset, UINT* lineno, UINT* colno)
+{
+	const char* checkpoint= buffer + (offset / stride) * stride;
+	const char* ptr= buffer + offset;
+	const char* linestart;
+	UINT n= sxml_countlines (checkpoint, ptr, &linestart);
+
+	/* Line started before the checkpoint - look back for it */
+	if (n == 0)
+	{
+		for (linestart= checkpoint; linestart != buffer && linestart[-1] != '\n'; linestart--)
+			;
+	}
+
+	*lineno= lines[offset / stride] + n + 1;
+	*colno= (UINT) (ptr - linestart) + 1;
+}
@@ -0,0 +1,29 @@
+#ifndef _SXML_LINES_H_INCLUDED
+#define _SXML_LINES_H_INCLUDED
+
+#include "sxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ --- SXML lines ---
+ Optional helper for reporting where a token is.
+ SXML_FLAG_LINES only tells you the line the parser is at.
+
+ To find the line and column of any token in a document you keep in memory, build a table of line counts at every 'stride' bytes.
+ 'lines' must have room for bufferlen / stride + 1 entries.
+
+ A lookup then only counts lines from the closest entry before the offset.
+ You may wait to build the table until you have a diagnostic to report.
+*/
+
+void sxml_index_lines(const char *buffer, unsigned bufferlen, unsigned stride, unsigned *lines);
+void sxml_find_line(const char *buffer, unsigned stride, const unsigned *lines, unsigned offset, unsigned *lineno, unsigned *colno);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SXML_LINES_H_INCLUDED */
@@ -0,0 +1,115 @@
+#include "sxml_pipe.h"
+
+#include <string.h>	/* memcpy */
+#include <assert.h>	/* assert */
+
+typedef unsigned UINT;
+typedef int BOOL;
+
+void sxml_pipe_init (sxmlpipe_t* pipe, sxmlbatch_t* batches, UINT num_batches)
+{
+	assert (2 <= num_batches && (num_batches & (num_batches - 1)) == 0);
+
+	sxml_init (&pipe->parser);
+	pipe->batches= batches;
+	pipe->num_batches= num_batches;
+	atomic_init (&pipe->head, 0);
+	atomic_init (&pipe->tail, 0);
+}
+
+/* MARK: Parser thread */
+
+static sxmlbatch_t* pipe_nextbatch (sxmlpipe_t* pipe, const sxmlsource_t* source)
+{
+	UINT head= atomic_load_explicit (&pipe->head, memory_order_relaxed);
+
+	/* Wait for the consumer to release the batch we are about to reuse */
+	while (head - atomic_load_explicit (&pipe->tail, memory_order_acquire) == pipe->num_batches)
+	{
+		if (source->wait != NULL)
+			source->wait (source->user);
+	}
+
+	return &pipe->batches[head & (pipe->num_batches - 1)];
+}
+
+static void pipe_publish (sxmlpipe_t* pipe, sxmlbatch_t* batch, sxmlerr_t err)
+{
+	batch->bufferlen= pipe->parser.bufferpos;
+	batch->ntokens= pipe->parser.ntokens;
+	batch->err= err;
+
+	atomic_store_explicit (&pipe->head, atomic_load_explicit (&pipe->head, memory_order_relaxed) + 1, memory_order_release);
+}
+
+sxmlerr_t sxml_pipe_produce (sxmlpipe_t* pipe, const sxmlsource_t* source)
+{
+	sxml_t* parser= &pipe->parser;
+	const char* carry= NULL;
+	UINT carrylen= 0;
+
+	for (;;)
+	{
+		sxmlbatch_t* batch= pipe_nextbatch (pipe, source);
+		UINT len= carrylen;
+		sxmlerr_t err;
+
+		/* Continue with what the previous segment could not tokenize */
+		assert (carrylen <= batch->buffersize);
+		if (carrylen != 0)
+			memcpy (batch->buffer, carry, carrylen);
+
+		parser->bufferpos= 0;
+		parser->ntokens= 0;
+
+		for (;;)
+		{
+			UINT n;
+
+			err= sxml_parse (parser, batch->buffer, len, batch->tokens, batch->num_tokens);
+			if (err != SXML_ERROR_BUFFERDRY || len == batch->buffersize)
+				break;
+
+			n= source->read (source->user, batch->buffer + len, batch->buffersize - len);
+			if (n == 0)
+			{
+				/* A stream of documents may end between any two of them */
+				BOOL streamend= (parser->flags & SXML_FLAG_STREAM) && parser->taglevel == 0 && parser->bufferpos == len;
+				err= streamend ? SXML_SUCCESS : SXML_ERROR_XMLINVALID;
+				break;
+			}
+
+			len+= n;
+		}
+
+		/* Parser made no progress - next segment would start out the same */
+		if ((err == SXML_ERROR_BUFFERDRY || err == SXML_ERROR_TOKENSFULL) && parser->bufferpos == 0)
+			err= SXML_ERROR_XMLINVALID;
+
+		carry= batch->buffer + parser->bufferpos;
+		carrylen= len - parser->bufferpos;
+		pipe_publish (pipe, batch, err);
+
+		if (err == SXML_SUCCESS || err == SXML_ERROR_XMLINVALID)
+			return err;
+	}
+}
+
+/* MARK: Consumer thread */
+
+const sxmlbatch_t* sxml_pipe_acquire (sxmlpipe_t* pipe)
+{
+	UINT tail= atomic_load_explicit (&pipe->tail, memory_order_relaxed);
+	if (tail == atomic_load_explicit (&pipe->head, memory_order_acquire))
+		return NULL;
+
+	return &pipe->batches[tail & (pipe->num_batches - 1)];
+}
+
+void sxml_pipe_release (sxmlpipe_t* pipe)
+{
+	UINT tail= atomic_load_explicit (&pipe->tail, memory_order_relaxed);
+	assert (tail != atomic_load_explicit (&pipe->head, memory_order_relaxed));
+
+	atomic_store_explicit (&pipe->tail, tail + 1, memory_order_release);
+}
@@ -0,0 +1,100 @@
+#ifndef _SXML_PIPE_H_INCLUDED
+#define _SXML_PIPE_H_INCLUDED
+
+#include "sxml.h"
+#include <stdatomic.h>
+
+/*
+ --- SXML pipe ---
+ Optional helper for tokenizing XML on one thread while the tokens are processed on another.
+ Unlike the parser itself it requires C11 atomics.
+
+ The parser thread reads input into a segment, tokenizes it and publishes the segment together with its tokens as a batch.
+ The consumer thread takes batches in order and releases each one when done with it.
+ Batches are passed through a lock-free ring with a single producer and a single consumer.
+ A segment is only filled again after the consumer has released it - if all are in use the parser thread waits.
+
+ Each batch is self contained - token offsets refer to the buffer of the same batch.
+ Input that could not be tokenized at the end of one segment is copied to the start of the next.
+
+ You provide the memory for the batches.
+ Set up 'buffer', 'buffersize', 'tokens' and 'num_tokens' of each one before calling sxml_pipe_init().
+*/
+
+typedef struct sxmlbatch_t sxmlbatch_t;
+struct sxmlbatch_t
+{
+	char *buffer;
+	sxmltok_t *tokens;
+	unsigned buffersize;
+	unsigned num_tokens;
+
+	/* Filled in by the parser thread */
+	unsigned bufferlen;	/* Bytes of input in 'buffer' */
+	unsigned ntokens;	/* Tokens filled with data */
+	sxmlerr_t err;		/* SXML_SUCCESS or SXML_ERROR_XMLINVALID marks the last batch - any other value means more batches follow */
+};
+
+/*
+ The parser thread gets its input from a source.
+ 'read' returns the number of bytes read - zero at the end of input.
+ 'wait' is called while all batches are in use by the consumer - NULL to keep trying without waiting.
+*/
+
+typedef struct sxmlsource_t sxmlsource_t;
+struct sxmlsource_t
+{
+	unsigned (*read)(void *user, char *buffer, unsigned len);
+	void (*wait)(void *user);
+	void *user;
+};
+
+typedef struct sxmlpipe_t sxmlpipe_t;
+struct sxmlpipe_t
+{
+	sxml_t parser;	/* Set up any parser options after sxml_pipe_init() */
+
+	/* Used internally */
+	sxmlbatch_t *batches;
+	unsigned num_batches;
+	atomic_uint head;	/* Number of batches published by the parser thread */
+	atomic_uint tail;	/* Number of batches released by the consumer thread */
+};
+
+/* 'num_batches' must be a power of two and at least 2 */
+void sxml_pipe_init(sxmlpipe_t *pipe, sxmlbatch_t *batches, unsigned num_batches);
+
+/*
+ Run on the parser thread - returns when the last batch has been published.
+ SXML_ERROR_XMLINVALID is also returned if the input ends before the document, or a single token does not fit in a segment.
+ With SXML_FLAG_STREAM the input may end after any complete document.
+*/
+
+sxmlerr_t sxml_pipe_produce(sxmlpipe_t *pipe, const sxmlsource_t *source);
+
+/*
+ Run on the consumer thread.
+ sxml_pipe_acquire() returns the oldest batch not yet released - NULL if the parser thread has not published it yet.
+ sxml_pipe_release() hands that batch back to the parser thread.
+
+ const sxmlbatch_t* batch;
+ sxmlerr_t err;
+ do
+ {
+	while ((batch= sxml_pipe_acquire (&pipe)) == NULL)
+		sched_yield ();
+
+	... process 'batch->ntokens' tokens of 'batch->tokens' with 'batch->buffer'
+
+	err= batch->err;
+	sxml_pipe_release (&pipe);
+ }
+ while (err != SXML_SUCCESS && err != SXML_ERROR_XMLINVALID);
+
+ Don't touch the batch after releasing it - the parser thread may already be filling it again.
+*/
+
+const sxmlbatch_t* sxml_pipe_acquire(sxmlpipe_t *pipe);
+void sxml_pipe_release(sxmlpipe_t *pipe);
+
+#endif /* _SXML_PIPE_H_INCLUDED */
@@ -0,0 +1,255 @@
+#include "sxml_reparse.h"
+#include "sxml_internal.h"
+
+#include <string.h>	/* memchr, memmove */
+#include <assert.h>	/* assert */
+
+#define MIN(a,b)	((a) < (b) ? (a) : (b))
+#define ROOT_PARSED(state)	((state)->taglevel == 0)
+
+/*
+ MARK: Reparse
+ Text is tokenized again from the start tag of the innermost element enclosing the edit,
+ but only until a new start or end tag lines up with an old one at the same depth - from there on the parser would produce the same tokens.
+ Tags are used for this as they can't be confused with any other construct.
+*/
+
+#define REPARSE_STEP	64	/* Number of tokens parsed between each attempt to line up with the old tokens */
+
+typedef struct
+{
+	UINT pos;		/* Start of edit - text before this position is unchanged */
+	UINT oldend;	/* End of replaced text in the old buffer */
+	UINT newend;	/* End of replacement text in the new buffer */
+	long delta;		/* Change in text length - applied to all token offsets after the edit */
+} sxml_edit_t;
+
+static int token_depthchange (const sxmltok_t* token)
+{
+	switch (token->type)
+	{
+		case SXML_STARTTAG:	return 1;
+		case SXML_ENDTAG:	return -1;
+	}
+
+	return 0;
+}
+
+/*
+ Returns the first token after the last one that starts before 'pos' - the search for a parent element goes back from there.
+ 'startpos' is not in order, so this is a scan back from the end rather than a binary search:
+ the end tag of an empty element '<a k="v"/>' points at the name in its start tag, before the attributes.
+ End tags are passed over for the same reason - reparse_findparent() checks where each one it finds on its way forward is.
+*/
+static UINT tokens_findedit (const sxmltok_t tokens[], UINT num_tokens, UINT pos)
+{
+	while (0 < num_tokens && (tokens[num_tokens - 1].type == SXML_ENDTAG || pos <= tokens[num_tokens - 1].startpos))
+		num_tokens--;
+
+	return num_tokens;
+}
+
+static void tokens_reverse (sxmltok_t* first, sxmltok_t* last)
+{
+	while (first < last && first < --last)
+	{
+		sxmltok_t tmp= *first;
+		*first++= *last;
+		*last= tmp;
+	}
+}
+
+/*
+ Search backward from token 'i' for the start tag of an element that encloses the edit.
+ 'end' is the position of the forward search for matching end tags - it is advanced with each element passed.
+ Returns 'ntokens' if there is no such element.
+*/
+static UINT reparse_findparent (const char* buffer, const sxmltok_t tokens[], UINT ntokens, const sxml_edit_t* edit, UINT i, UINT* end)
+{
+	UINT depth= 0;
+
+	while (0 < i)
+	{
+		const sxmltok_t* token= &tokens[--i];
+		UINT from, d;
+
+		if (token->type == SXML_ENDTAG)
+			depth++;
+
+		if (token->type != SXML_STARTTAG)
+			continue;
+
+		if (0 < depth)
+		{
+			depth--;
+			continue;
+		}
+
+		/* Find the matching end tag */
+		for (d= 0; *end < ntokens; ++*end)
+		{
+			const sxmltok_t* it= &tokens[*end];
+			if (it->type == SXML_ENDTAG && d == 0)
+				break;
+
+			d+= token_depthchange (it);
+		}
+
+		if (*end == ntokens)
+			return ntokens;
+
+		++*end;
+		if (tokens[*end - 1].startpos - 2 < edit->oldend)
+			continue;
+
+		/* Start tag must end before the edit - look for '>' after its last attribute */
+		from= tokens[i + token->size].endpos;
+		if (from < edit->pos && memchr (buffer + from, '>', edit->pos - from) != NULL)
+			return i;
+	}
+
+	return ntokens;
+}
+
+/* Line and column of 'bufferpos' are counted again from the start of the buffer - the text they were counted over has changed */
+static void reparse_lines (sxml_t* state, const char* buffer)
+{
+	const char* linestart;
+	const char* end= buffer + state->bufferpos;
+
+	if (!(state->flags & SXML_FLAG_LINES))
+		return;
+
+	state->lineno= sxml_countlines (buffer, end, &linestart) + 1;
+	state->colno= (UINT) (end - linestart) + 1;
+}
+
+/* Replace old tokens 'first' to 'last' with 'n' tokens found after the end of the token table */
+static void reparse_apply (sxml_t* state, sxmltok_t tokens[], UINT first, UINT last, UINT n, long delta)
+{
+	UINT i, ntail= state->ntokens - last;
+
+	for (i= last; i < state->ntokens; i++)
+	{
+		tokens[i].startpos= (UINT) (tokens[i].startpos + delta);
+		tokens[i].endpos= (UINT) (tokens[i].endpos + delta);
+	}
+
+	/* Tail and new tokens are moved down together, then swapped in place */
+	memmove (tokens + first, tokens + last, (ntail + n) * sizeof (sxmltok_t));
+	tokens_reverse (tokens + first, tokens + first + ntail);
+	tokens_reverse (tokens + first + ntail, tokens + first + ntail + n);
+	tokens_reverse (tokens + first, tokens + first + ntail + n);
+
+	state->ntokens= first + n + ntail;
+}
+
+/*
+ Tokenize from start tag 'first' - or from the start of the document if 'whole' is set.
+ Returns SXML_ERROR_BUFFERDRY if the new tokens never lined up with the old ones.
+*/
+static sxmlerr_t reparse_from (sxml_t* state, const char* buffer, UINT bufferlen, sxmltok_t tokens[], UINT num_tokens, UINT first, BOOL whole, const sxml_edit_t* edit)
+{
+	const UINT ntokens= state->ntokens;
+	sxmltok_t* scratch= tokens + ntokens;
+	UINT nscratch= num_tokens - ntokens;
+	UINT n= 0, limit= 0, old= first;
+	int newdepth= 0, olddepth= 0;
+
+	sxml_t temp= *state;
+	temp.bufferpos= whole ? 0 : tokens[first].startpos - 1;
+	temp.ntokens= 0;
+	temp.taglevel= 0;
+	temp.textrun= 0;
+
+	/* An element is parsed as if it was a document of its own */
+	if (!whole)
+		temp.flags&= ~SXML_FLAG_STREAM;
+
+	temp.bytebudget= 0;
+	temp.tokenbudget= 0;
+
+	for (;;)
+	{
+		sxmlerr_t err;
+
+		limit= MIN (limit + REPARSE_STEP, nscratch);
+		err= sxml_parse (&temp, buffer, bufferlen, scratch, limit);
+
+		/* A stream of documents ends when the buffer does */
+		if (err == SXML_ERROR_BUFFERDRY && (temp.flags & SXML_FLAG_STREAM) && ROOT_PARSED (&temp) && temp.bufferpos == bufferlen)
+			err= SXML_SUCCESS;
+
+		if (err != SXML_SUCCESS && !(err == SXML_ERROR_TOKENSFULL && limit < nscratch))
+			return err;
+
+		for (; n < temp.ntokens; n++)
+		{
+			const sxmltok_t* token= &scratch[n];
+			if (token_depthchange (token) != 0 && edit->newend + 2 <= token->startpos)
+			{
+				UINT pos= (UINT) (token->startpos - edit->delta);
+				for (; old < ntokens && tokens[old].startpos < pos; old++)
+					olddepth+= token_depthchange (&tokens[old]);
+
+				if (old < ntokens && olddepth == newdepth &&
+					tokens[old].type == token->type && tokens[old].size == token->size &&
+					tokens[old].startpos == pos && tokens[old].endpos + edit->delta == token->endpos)
+				{
+					reparse_apply (state, tokens, first, old, n, edit->delta);
+					state->bufferpos= (UINT) (state->bufferpos + edit->delta);
+					reparse_lines (state, buffer);
+					return SXML_SUCCESS;
+				}
+			}
+
+			newdepth+= token_depthchange (token);
+		}
+
+		if (err == SXML_SUCCESS)
+			break;
+	}
+
+	if (!whole)
+		return SXML_ERROR_BUFFERDRY;
+
+	reparse_apply (state, tokens, 0, ntokens, n, edit->delta);
+	state->bufferpos= temp.bufferpos;
+	reparse_lines (state, buffer);
+	return SXML_SUCCESS;
+}
+
+sxmlerr_t sxml_reparse (sxml_t* state, const char* buffer, UINT bufferlen, sxmltok_t tokens[], UINT num_tokens, UINT editpos, UINT oldlen, UINT newlen)
+{
+	sxml_edit_t edit;
+	UINT first, end;
+
+	assert (ROOT_PARSED (state) && state->ntokens <= num_tokens);
+	assert (editpos + newlen <= bufferlen);
+
+	/* Nothing to do for edits past the end of the document - a stream of documents runs to the end of the buffer */
+	if (state->bufferpos <= editpos && !(state->flags & SXML_FLAG_STREAM))
+		return SXML_SUCCESS;
+
+	edit.pos= editpos;
+	edit.oldend= editpos + oldlen;
+	edit.newend= editpos + newlen;
+	edit.delta= (long) newlen - (long) oldlen;
+
+	first= end= tokens_findedit (tokens, state->ntokens, editpos);
+	for (;;)
+	{
+		sxmlerr_t err;
+
+		first= reparse_findparent (buffer, tokens, state->ntokens, &edit, first, &end);
+		if (first == state->ntokens)
+			break;
+
+		/* Try again with the parent element if the edit changed where this element ends */
+		err= reparse_from (state, buffer, bufferlen, tokens, num_tokens, first, FALSE, &edit);
+		if (err != SXML_ERROR_BUFFERDRY)
+			return err;
+	}
+
+	return reparse_from (state, buffer, bufferlen, tokens, num_tokens, 0, TRUE, &edit);
+}
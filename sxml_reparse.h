@@ -0,0 +1,39 @@
+#ifndef _SXML_REPARSE_H_INCLUDED
+#define _SXML_REPARSE_H_INCLUDED
+
+#include "sxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ --- SXML reparse ---
+ Optional helper for editors.
+ If you keep a whole document in memory together with its token table you don't have to parse it all again after a small edit.
+
+ Apply the edit to the text, then let sxml_reparse() update the tokens.
+ The edit replaced 'oldlen' bytes at 'editpos' with 'newlen' bytes - 'buffer' is the new text.
+
+ Only the innermost element enclosing the edit is tokenized again - and only until the new tokens line up with the old ones.
+ Tokens after that are kept and their offsets shifted.
+
+ The parser must have completed the document (SXML_SUCCESS) starting from offset 0, and 'ntokens' must cover all of it.
+ With SXML_FLAG_STREAM the parser must have consumed all documents in the buffer.
+ Token types SXML_STARTTAG and SXML_ENDTAG should not be skipped, as they are used to find where to start and stop.
+ The unused tokens at the end of the table ('num_tokens' - 'ntokens') are used as scratch space for the new tokens.
+ With SXML_FLAG_LINES, 'lineno' and 'colno' are counted again from the start of the buffer, as the edit may have added or removed lines before 'bufferpos'.
+
+ On any error the parser and tokens are left unchanged:
+ * SXML_ERROR_TOKENSFULL - provide a larger token table and try again
+ * SXML_ERROR_XMLINVALID - the edited text is not valid XML
+ * SXML_ERROR_BUFFERDRY - the edited text is not a complete document
+*/
+
+sxmlerr_t sxml_reparse(sxml_t *parser, const char *buffer, unsigned bufferlen, sxmltok_t *tokens, unsigned num_tokens, unsigned editpos, unsigned oldlen, unsigned newlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SXML_REPARSE_H_INCLUDED */
@@ -123,27 +123,6 @@ static void print_prettyxml (const char* buffer, const sxmltok_t tokens[], UINT
 	}
 }
 
-/*
- MARK: Utility functions
- Useful for error reporting.
-*/
-static UINT count_lines (const char* buffer, UINT bufferlen)
-{
-	const char* end= buffer + bufferlen;
-	const char* it= buffer;
-	UINT i;
-
-	for (i= 0; ; i++)
-	{
-		it= (const char*) memchr (it, '\n', end - it);
-		if (it == NULL)
-			return i;
-
-		it++;
-	}
-}
-
-
 /*
  MARK: main
  Minimal example showing how you may use SXML within a constrained environment with a fixed size input and output buffer.
@@ -164,8 +143,8 @@ int main (int argc, const char* argv[])
 	/* Output token table */
 	sxmltok_t tokens[128];
 
-	/* Used in example for pretty printing and error reporting */
-	UINT indent= 0, lineno= 1;
+	/* Used in example for pretty printing */
+	UINT indent= 0;
 
 	const char* path;
 	FILE* file;
@@ -174,6 +153,9 @@ int main (int argc, const char* argv[])
 	sxml_t parser;
 	sxml_init (&parser);
 
+	/* Have the parser keep track of line numbers for error reporting */
+	parser.flags= SXML_FLAG_LINES;
+
 	/* Usage: sxml_test.exe test.xml */
 	assert (argc == 2);
 	path= argv[1];
@@ -217,9 +199,6 @@ int main (int argc, const char* argv[])
 				print_prettyxml (buffer, tokens, parser.ntokens, &indent);
 				parser.ntokens= 0;
 
-				/* For error reporting */
-				lineno+= count_lines(buffer, parser.bufferpos);
-
 				/*
 				 Example of how to reuse buffer array.
 				 Move unprocessed buffer content to start of array
@@ -249,8 +228,7 @@ int main (int argc, const char* argv[])
 				char fmt[8];
 
 				/* Example of some simple error reporting */
-				lineno+= count_lines (buffer, parser.bufferpos);
-				fprintf(stderr, "Error while parsing line %d:\n", lineno);
+				fprintf(stderr, "Error while parsing line %d, column %d:\n", parser.lineno, parser.colno);
 
 				/* Print out contents of line containing the error */
 				sprintf (fmt, "%%.%ds", MIN (bufferlen - parser.bufferpos, 72));
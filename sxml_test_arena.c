@@ -0,0 +1,228 @@
+#include "sxml_arena.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Arena test ---
+ Checks how sxml_parse_alloc() grows the token table, and sxml_arena_grow() underneath it:
+ * the last allocation from the arena grows in place, any other one is copied
+ * a table grown from nothing holds the same tokens as a fixed table large enough for the document
+ * an arena that runs out returns SXML_ERROR_TOKENSFULL with 'tokens' and 'num_tokens' describing the table so far
+ * a table whose doubled size would not fit in an unsigned is not grown
+
+ Usage: sxml_test_arena
+
+ Prints 'ok' and returns zero if all checks pass.
+*/
+
+static int check (int ok, const char* what)
+{
+	if (!ok)
+		printf ("Failed: %s\n", what);
+
+	return ok;
+}
+
+/* MARK: Arena */
+
+static double memory[16 * 1024];	/* Aligned for any type */
+
+static int test_arena (void)
+{
+	sxmlarena_t arena;
+	char* a, *b, *c;
+	UINT i;
+	int ok= 1;
+
+	sxml_arena_init (&arena, memory, sizeof (memory));
+
+	/* Last allocation grows in place */
+	a= (char*) sxml_arena_grow (&arena, NULL, 0, 100);
+	for (i= 0; i < 100; i++)
+		a[i]= (char) i;
+
+	ok&= check (a == (char*) memory, "first allocation at start of memory");
+	ok&= check (sxml_arena_grow (&arena, a, 100, 300) == a && arena.used == 300, "grow last allocation in place");
+
+	/* Not the last allocation any more - grown by copying */
+	b= (char*) sxml_arena_grow (&arena, NULL, 0, 5);
+	c= (char*) sxml_arena_grow (&arena, a, 100, 200);
+
+	ok&= check (b != NULL && (b - (char*) memory) % sizeof (double) == 0, "second allocation aligned");
+	ok&= check (sxml_arena_grow (&arena, NULL, 0, UINT_MAX - 1) == NULL, "allocation size close to UINT_MAX");
+	ok&= check (c != NULL && c != a && (c - (char*) memory) % sizeof (double) == 0, "grow by copying");
+	if (c != NULL)
+	{
+		for (i= 0; i < 100; i++)
+			ok&= check (c[i] == (char) i, "copied contents");
+	}
+
+	/* The copy is now the last allocation */
+	ok&= check (sxml_arena_grow (&arena, c, 200, 400) == c, "grow copy in place");
+
+	/* Out of memory */
+	ok&= check (sxml_arena_grow (&arena, c, 400, sizeof (memory)) == NULL, "grow in place beyond end of memory");
+	ok&= check (sxml_arena_grow (&arena, b, 5, sizeof (memory)) == NULL, "grow by copying beyond end of memory");
+
+	return ok;
+}
+
+/* MARK: Parsing */
+
+static char document[16 * 1024];
+static UINT documentlen;
+
+static sxmltok_t expected[4096];
+static sxml_t full;
+
+static void document_generate (void)
+{
+	UINT i;
+
+	documentlen= (UINT) sprintf (document, "<?xml version='1.0'?>\n<list>\n");
+	for (i= 0; i < 100; i++)
+		documentlen+= (UINT) sprintf (document + documentlen, "  <item id='%u' note=\"a &amp; b\">text &lt; %u<!-- %u --></item>\n", i, i, i);
+
+	documentlen+= (UINT) sprintf (document + documentlen, "</list>\n");
+
+	sxml_init (&full);
+	if (sxml_parse (&full, document, documentlen, expected, 4096) != SXML_SUCCESS)
+	{
+		fprintf (stderr, "Generated document does not parse\n");
+		exit (EXIT_FAILURE);
+	}
+}
+
+static int compare (const sxml_t* parser, const sxmltok_t* tokens, UINT offset)
+{
+	return offset + parser->ntokens <= full.ntokens && memcmp (tokens, expected + offset, parser->ntokens * sizeof (sxmltok_t)) == 0;
+}
+
+/* Allocates a small block from the arena before each grow - the table is never the last allocation */
+static void* grow_fragmented (void* user, void* ptr, UINT oldsize, UINT newsize)
+{
+	if (sxml_arena_grow (user, NULL, 0, 8) == NULL)
+		return NULL;
+
+	return sxml_arena_grow (user, ptr, oldsize, newsize);
+}
+
+static int test_parse (void)
+{
+	sxmlarena_t arena;
+	sxmlalloc_t alloc;
+	sxmltok_t* tokens= NULL;
+	UINT num_tokens= 0, offset= 0;
+	sxml_t parser;
+	sxmlerr_t err;
+	int ok= 1;
+
+	alloc.grow= sxml_arena_grow;
+	alloc.user= &arena;
+
+	/* Whole document in one call - the table is the only allocation, so it grows in place */
+	sxml_arena_init (&arena, memory, sizeof (memory));
+	sxml_init (&parser);
+	err= sxml_parse_alloc (&parser, document, documentlen, &tokens, &num_tokens, &alloc);
+
+	ok&= check (err == SXML_SUCCESS && memcmp (&parser, &full, sizeof (sxml_t)) == 0 && compare (&parser, tokens, 0), "table grown from nothing");
+	ok&= check (tokens == (sxmltok_t*) memory && full.ntokens <= num_tokens && num_tokens < 2 * full.ntokens, "table grown in place");
+
+	/* Each grow has to copy the table */
+	tokens= NULL;
+	num_tokens= 0;
+	alloc.grow= grow_fragmented;
+
+	sxml_arena_init (&arena, memory, sizeof (memory));
+	sxml_init (&parser);
+	err= sxml_parse_alloc (&parser, document, documentlen, &tokens, &num_tokens, &alloc);
+
+	ok&= check (err == SXML_SUCCESS && memcmp (&parser, &full, sizeof (sxml_t)) == 0 && compare (&parser, tokens, 0), "table grown by copying");
+	ok&= check (tokens != (sxmltok_t*) memory, "table moved");
+
+	/* Room for 128 tokens but not 256 - the caller handles SXML_ERROR_TOKENSFULL with the table it got */
+	tokens= NULL;
+	num_tokens= 0;
+	alloc.grow= sxml_arena_grow;
+
+	sxml_arena_init (&arena, memory, 200 * sizeof (sxmltok_t));
+	sxml_init (&parser);
+	err= sxml_parse_alloc (&parser, document, documentlen, &tokens, &num_tokens, &alloc);
+
+	ok&= check (err == SXML_ERROR_TOKENSFULL && tokens == (sxmltok_t*) memory && num_tokens == 128, "table updated when arena runs out");
+	ok&= check (0 < parser.ntokens && parser.ntokens <= num_tokens && compare (&parser, tokens, 0), "tokens before arena ran out");
+
+	while (err == SXML_ERROR_TOKENSFULL && compare (&parser, tokens, offset))
+	{
+		offset+= parser.ntokens;
+		parser.ntokens= 0;
+		err= sxml_parse_alloc (&parser, document, documentlen, &tokens, &num_tokens, &alloc);
+	}
+
+	ok&= check (err == SXML_SUCCESS && num_tokens == 128 && compare (&parser, tokens, offset) && offset + parser.ntokens == full.ntokens, "continue after arena ran out");
+	return ok;
+}
+
+/*
+ MARK: Size limit
+ The table is never really grown - 'num_tokens' only claims it is that large.
+ It is full from the start, so no token is written to it.
+*/
+
+static UINT lastsize;
+
+static void* grow_refuse (void* user, void* ptr, UINT oldsize, UINT newsize)
+{
+	(void) user;
+	(void) ptr;
+	(void) oldsize;
+
+	lastsize= newsize;
+	return NULL;
+}
+
+static int test_limit (UINT num_tokens, UINT newsize)
+{
+	sxmltok_t table[1];
+	sxmltok_t* tokens= table;
+	sxmlalloc_t alloc;
+	sxml_t parser;
+	sxmlerr_t err;
+
+	alloc.grow= grow_refuse;
+	alloc.user= NULL;
+	lastsize= 0;
+
+	sxml_init (&parser);
+	parser.ntokens= num_tokens;
+	err= sxml_parse_alloc (&parser, "<a/>", 4, &tokens, &num_tokens, &alloc);
+
+	return err == SXML_ERROR_TOKENSFULL && tokens == table && parser.ntokens == num_tokens && lastsize == newsize;
+}
+
+/* MARK: main */
+
+int main (void)
+{
+	const UINT maxtokens= UINT_MAX / 2 / sizeof (sxmltok_t);
+	int ok= 1;
+
+	ok&= test_arena ();
+
+	document_generate ();
+	ok&= test_parse ();
+
+	ok&= check (test_limit (maxtokens, 2 * maxtokens * sizeof (sxmltok_t)), "largest table that may be doubled");
+	ok&= check (test_limit (maxtokens + 1, 0), "table too large to double");
+
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,437 @@
+#include "sxml_async.hpp"
+#include "sxml_test_output.h"
+
+#include <cstdio>	/* std::printf, std::snprintf */
+#include <cstdlib>	/* EXIT_SUCCESS, EXIT_FAILURE */
+#include <string>	/* std::string */
+#include <vector>	/* std::vector */
+#include <memory>	/* std::unique_ptr */
+
+#ifdef __linux__
+#include <fcntl.h>	/* fcntl */
+#include <unistd.h>	/* write, close */
+#include <sys/socket.h>	/* socketpair, shutdown */
+#include <sys/resource.h>	/* getrlimit, setrlimit */
+#endif
+
+/*
+ --- Async test ---
+ The batches of sxml::parse_async() must describe the same tokens as parsing the whole input in one call.
+ A generated document is fed to a memory_source in pieces of varying size, with several buffer and token table sizes, with and without a work budget.
+ Input that ends early must be reported as SXML_ERROR_XMLINVALID.
+
+ On Linux a busy connection and a quiet one share an epoll_loop.
+ The busy connection awaits reschedule() on SXML_YIELD - the quiet one must complete while the busy one still has input left.
+ Coroutines waiting in reschedule() must be resumed once per run(), in the order they were queued and after a reader whose input arrived.
+ 2000 connections over socket pairs share one epoll_loop, with input that arrives in two parts - each must give the same tokens as parsing it in one call.
+
+ Usage: sxml_test_async
+
+ Prints 'ok' and returns zero if all checks pass.
+ Requires C++20 - link with sxml.c.
+*/
+
+namespace
+{
+	/* MARK: Output */
+
+	struct output
+	{
+		std::vector<char> data;
+		output_t dump;
+		sxmlerr_t err= SXML_ERROR_BUFFERDRY;
+		bool done= false;
+		unsigned batches= 0;
+
+		explicit output (unsigned size) : data (size)	{ output_init (&dump, data.data (), size); }
+		output (const output&)= delete;
+	};
+
+	/* MARK: Input */
+
+	std::string generate (unsigned items)
+	{
+		std::string xml= "<?xml version=\"1.0\"?>\n<root>\n";
+		for (unsigned i= 0; i < items; i++)
+		{
+			char item[256];
+			std::snprintf (item, sizeof (item),
+				"  <item id=\"%u\" note='a &lt; b'>\n"
+				"    <name>Item &amp; %u</name><!-- %u -->\n"
+				"    <![CDATA[<raw>]]>%s\n"
+				"  </item>\n", i, i, i, (i % 5 == 0) ? " text that runs on past a small buffer" : "");
+			xml+= item;
+		}
+
+		return xml + "</root>\n";
+	}
+
+	unsigned seed= 1;
+
+	unsigned next_random (unsigned n)
+	{
+		seed= seed * 1103515245u + 12345u;
+		return (seed >> 16) % n;
+	}
+
+	/* MARK: Readers */
+
+	template <class Source>
+	sxml::detached consume (Source& source, unsigned flags, unsigned buffersize, unsigned num_tokens, unsigned bytebudget, output& out)
+	{
+		std::vector<char> buffer (buffersize);
+		std::vector<sxmltok_t> tokens (num_tokens);
+		sxml_t parser;
+
+		sxml_init (&parser);
+		parser.flags= flags;
+		parser.bytebudget= bytebudget;
+
+		auto batches= sxml::parse_async (source, parser, buffer.data (), buffersize, tokens.data (), num_tokens);
+		while (const sxml::batch* batch= co_await batches.next ())
+		{
+			output_tokens (&out.dump, batch->buffer, batch->tokens, batch->ntokens);
+			out.err= batch->err;
+			out.batches++;
+		}
+
+		out.done= true;
+	}
+
+	bool test_memory (const std::string& xml)
+	{
+		static const unsigned flagsets[]= {0, SXML_FLAG_COALESCE, SXML_FLAG_NOSPACE | SXML_FLAG_UTF8, SXML_FLAG_STREAM, SXML_FLAG_STREAM | SXML_FLAG_NOSPACE | SXML_FLAG_COALESCE | SXML_FLAG_LINES};
+
+		const unsigned outputsize= 2 * (unsigned) xml.size ();
+
+		for (unsigned flags : flagsets)
+		{
+			sxml::memory_source whole;
+			output expected (outputsize);
+
+			consume (whole, flags, (unsigned) xml.size (), (unsigned) xml.size (), 0, expected);
+			whole.feed (xml.data (), (unsigned) xml.size ());
+			whole.close ();
+
+			for (int run= 0; run < 40; run++)
+			{
+				sxml::memory_source source;
+				output out (outputsize);
+				unsigned pos= 0;
+
+				consume (source, flags, 200 + next_random (300), 16 + next_random (40), (run % 2 != 0) ? 37 : 0, out);
+				while (pos < xml.size () && !out.done)
+				{
+					unsigned n= 1 + next_random (100);
+					if (xml.size () - pos < n)
+						n= (unsigned) xml.size () - pos;
+
+					source.feed (xml.data () + pos, n);
+					pos+= n;
+				}
+
+				if (!out.done)
+					source.close ();
+
+				if (!expected.done || !out.done || out.err != expected.err || !output_equal (&out.dump, &expected.dump))
+				{
+					std::printf ("Mismatch with flags %u in run %d\n", flags, run);
+					return false;
+				}
+			}
+		}
+
+		/* Input ends in the middle of the document */
+		sxml::memory_source source;
+		output out (outputsize);
+
+		consume (source, 0, 256, 32, 0, out);
+		source.feed (xml.data (), (unsigned) xml.size () / 2);
+		source.close ();
+
+		if (!out.done || out.err != SXML_ERROR_XMLINVALID)
+		{
+			std::printf ("Truncated input not reported as invalid\n");
+			return false;
+		}
+
+		return true;
+	}
+
+#ifdef __linux__
+	/* MARK: Fairness */
+
+	sxml::detached consume_fair (sxml::memory_source& source, sxml::epoll_loop& loop, output& out)
+	{
+		std::vector<char> buffer (64 * 1024);
+		std::vector<sxmltok_t> tokens (4096);
+		sxml_t parser;
+
+		sxml_init (&parser);
+		parser.bytebudget= 4096;
+
+		auto batches= sxml::parse_async (source, parser, buffer.data (), (unsigned) buffer.size (), tokens.data (), (unsigned) tokens.size ());
+		while (const sxml::batch* batch= co_await batches.next ())
+		{
+			out.err= batch->err;
+			out.batches++;
+
+			if (batch->err == SXML_YIELD)
+				co_await loop.reschedule ();
+		}
+
+		out.done= true;
+	}
+
+	bool test_fairness (const std::string& xml)
+	{
+		sxml::epoll_loop loop;
+		sxml::memory_source busysource;
+		output busy (256), quiet (256);
+		int sv[2];
+
+		if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+		{
+			std::printf ("socketpair failed\n");
+			return false;
+		}
+
+		fcntl (sv[0], F_SETFL, O_NONBLOCK);
+
+		{
+			static const char small[]= "<ping n='1'/>";
+			sxml::fd_source quietsource (sv[0], loop);
+
+			/* All input of the busy connection is there at once - it yields instead of parsing all of it now */
+			consume_fair (busysource, loop, busy);
+			busysource.feed (xml.data (), (unsigned) xml.size ());
+
+			consume (quietsource, 0, 256, 32, 0, quiet);
+			if (write (sv[1], small, sizeof (small) - 1) != (ssize_t) (sizeof (small) - 1))
+			{
+				std::printf ("write failed\n");
+				return false;
+			}
+
+			shutdown (sv[1], SHUT_WR);
+
+			for (int rounds= 0; !quiet.done && rounds < 4; rounds++)
+				loop.run (100);
+
+			if (!quiet.done || quiet.err != SXML_SUCCESS || busy.done)
+			{
+				std::printf ("Quiet connection waited for the busy one - quiet done %d, busy done %d\n", quiet.done, busy.done);
+				return false;
+			}
+
+			while (!busy.done)
+				loop.run (0);
+		}
+
+		close (sv[0]);
+		close (sv[1]);
+
+		if (busy.err != SXML_SUCCESS || busy.batches < 10)
+		{
+			std::printf ("Busy connection ended with %d after %u batches\n", busy.err, busy.batches);
+			return false;
+		}
+
+		return true;
+	}
+
+	/* MARK: Rescheduling */
+
+	sxml::detached spin (sxml::epoll_loop& loop, int id, int rounds, std::vector<int>& order)
+	{
+		for (int i= 0; i < rounds; i++)
+		{
+			order.push_back (id);
+			co_await loop.reschedule ();
+		}
+	}
+
+	sxml::detached read_ping (sxml::fd_source& source, std::vector<int>& order)
+	{
+		char buffer[64];
+		sxmltok_t tokens[8];
+		sxml_t parser;
+
+		sxml_init (&parser);
+
+		auto batches= sxml::parse_async (source, parser, buffer, sizeof (buffer), tokens, 8);
+		while (co_await batches.next ())
+			;
+
+		order.push_back (-1);
+	}
+
+	bool test_reschedule ()
+	{
+		static const char ping[]= "<ping/>";
+		static const std::vector<int> expected= {0, 1, 2, -1, 0, 1, 2, 0, 1, 2, 0, 1, 2};
+
+		sxml::epoll_loop loop;
+		std::vector<int> order;
+		int sv[2];
+
+		if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+		{
+			std::printf ("socketpair failed\n");
+			return false;
+		}
+
+		fcntl (sv[0], F_SETFL, O_NONBLOCK);
+
+		{
+			sxml::fd_source source (sv[0], loop);
+			read_ping (source, order);
+
+			/* Each queues itself once before the first run() */
+			for (int id= 0; id < 3; id++)
+				spin (loop, id, 4, order);
+
+			if (write (sv[1], ping, sizeof (ping) - 1) != (ssize_t) (sizeof (ping) - 1))
+			{
+				std::printf ("write failed\n");
+				return false;
+			}
+
+			shutdown (sv[1], SHUT_WR);
+
+			/* The reader first, then the others in the order they queued - once per run(), as they queue again while it runs */
+			for (int round= 0; round < 4; round++)
+			{
+				int resumed= loop.run (100);
+				if (resumed != ((round == 0) ? 4 : 3))
+				{
+					std::printf ("Run %d resumed %d coroutines\n", round, resumed);
+					return false;
+				}
+			}
+
+			if (order != expected || loop.run (0) != 0)
+			{
+				std::printf ("Rescheduled coroutines resumed out of order\n");
+				return false;
+			}
+		}
+
+		close (sv[0]);
+		close (sv[1]);
+		return true;
+	}
+
+	/* MARK: Connections */
+
+	struct connection
+	{
+		int sv[2];
+		std::unique_ptr<sxml::fd_source> source;
+		output out;
+
+		explicit connection (unsigned outputsize) : sv {-1, -1}, out (outputsize)	{}
+
+		~connection ()
+		{
+			source.reset ();
+			if (0 <= sv[0])
+				close (sv[0]);
+			if (0 <= sv[1])
+				close (sv[1]);
+		}
+	};
+
+	bool test_connections (unsigned num_connections)
+	{
+		const std::string xml= generate (20);
+		const unsigned half= (unsigned) xml.size () / 2;
+		const unsigned outputsize= 2 * (unsigned) xml.size ();
+
+		sxml::epoll_loop loop;
+		std::vector<std::unique_ptr<connection>> connections;
+		sxml::memory_source whole;
+		output expected (outputsize);
+		rlimit limit;
+
+		/* Two descriptors for each connection, and a few for the rest */
+		if (getrlimit (RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < 2 * num_connections + 64 && 2 * num_connections + 64 <= limit.rlim_max)
+		{
+			limit.rlim_cur= 2 * num_connections + 64;
+			setrlimit (RLIMIT_NOFILE, &limit);
+		}
+
+		consume (whole, 0, (unsigned) xml.size (), (unsigned) xml.size (), 0, expected);
+		whole.feed (xml.data (), (unsigned) xml.size ());
+		whole.close ();
+
+		for (unsigned i= 0; i < num_connections; i++)
+		{
+			connections.push_back (std::make_unique<connection> (outputsize));
+			connection& c= *connections.back ();
+
+			if (socketpair (AF_UNIX, SOCK_STREAM, 0, c.sv) != 0)
+			{
+				std::printf ("socketpair failed for connection %u - raise the limit on open files\n", i);
+				return false;
+			}
+
+			fcntl (c.sv[0], F_SETFL, O_NONBLOCK);
+			c.source= std::make_unique<sxml::fd_source> (c.sv[0], loop);
+			consume (*c.source, 0, 256, 32, 0, c.out);
+		}
+
+		/* All connections are waiting for input - each gets the first half, then the rest */
+		for (unsigned part= 0; part < 2; part++)
+		{
+			for (auto& c : connections)
+			{
+				const char* data= xml.data () + part * half;
+				ssize_t len= (ssize_t) ((part == 0) ? half : xml.size () - half);
+
+				if (write (c->sv[1], data, (size_t) len) != len)
+				{
+					std::printf ("write failed\n");
+					return false;
+				}
+
+				if (part == 1)
+					shutdown (c->sv[1], SHUT_WR);
+			}
+
+			while (0 < loop.run (0))
+				;
+		}
+
+		for (unsigned i= 0; i < num_connections; i++)
+		{
+			const output& out= connections[i]->out;
+			if (!out.done || out.err != expected.err || !output_equal (&out.dump, &expected.dump))
+			{
+				std::printf ("Connection %u ended with %d after %u batches\n", i, out.err, out.batches);
+				return false;
+			}
+		}
+
+		return true;
+	}
+#endif
+}
+
+/* MARK: main */
+
+int main ()
+{
+	std::string xml= generate (2000);
+
+	if (!test_memory (xml))
+		return EXIT_FAILURE;
+
+#ifdef __linux__
+	if (!test_fairness (xml) || !test_reschedule () || !test_connections (2000))
+		return EXIT_FAILURE;
+#endif
+
+	std::printf ("ok\n");
+	return EXIT_SUCCESS;
+}
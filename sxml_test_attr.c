@@ -0,0 +1,160 @@
+#include "sxml_attr.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Attribute index test ---
+ sxml_find_attribute() must find every attribute a walk over the tokens finds, and nothing else.
+ Start tags are parsed with and without SXML_FLAG_COALESCE, so attribute values of one token and of several are both indexed.
+ The names 'glbvs' and 'yacxa' have the same hash, so keys can only be told apart by their text.
+
+ Usage: sxml_test_attr
+
+ Prints 'ok' and returns zero if all lookups agree.
+*/
+
+#define NUM_SLOTS	16
+
+static sxmltok_t tokens[256];
+static sxmlattr_t slots[NUM_SLOTS];
+
+static int check (int ok, const char* what, const char* document, UINT flags)
+{
+	if (!ok)
+		printf ("Failed: %s with flags %u in %s\n", what, flags, document);
+
+	return ok;
+}
+
+/* Returns the concatenated text of the value tokens of an attribute */
+static UINT attr_value (const char* buffer, const sxmltok_t* token, const sxmlattr_t* attr, char* value)
+{
+	UINT i, len= 0;
+
+	for (i= 1; i <= attr->nvalues; i++)
+	{
+		const sxmltok_t* part= token + attr->key + i;
+		memcpy (value + len, buffer + part->startpos, part->endpos - part->startpos);
+		len+= part->endpos - part->startpos;
+	}
+
+	value[len]= '\0';
+	return len;
+}
+
+/* Every key found by walking the tokens has to be found through the index */
+static int test_walk (const char* document, UINT flags)
+{
+	const sxmltok_t* token= tokens;
+	UINT i;
+
+	for (i= 1; i <= token->size; i++)
+	{
+		const sxmltok_t* key= token + i;
+		const sxmlattr_t* attr;
+		UINT nvalues;
+
+		if (key->type != SXML_CDATA)
+			continue;
+
+		for (nvalues= 0; i + nvalues < token->size && key[nvalues + 1].type == SXML_CHARACTER; nvalues++)
+			;
+
+		attr= sxml_find_attribute (document, token, slots, NUM_SLOTS, document + key->startpos, key->endpos - key->startpos);
+		if (!check (attr != NULL && attr->key == i && attr->nvalues == nvalues, "walk and index disagree", document, flags))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int test_document (const char* document, UINT flags)
+{
+	static const char* missing[]= {"zz", "b", "bbb", "A", ""};
+
+	sxml_t parser;
+	const sxmlattr_t* attr;
+	char value[64];
+	UINT i;
+	int ok= 1;
+
+	sxml_init (&parser);
+	parser.flags= flags;
+	if (!check (sxml_parse (&parser, document, (UINT) strlen (document), tokens, 256) == SXML_SUCCESS, "parse", document, flags))
+		return 0;
+
+	if (!check (sxml_index_attributes (document, tokens, slots, NUM_SLOTS) == SXML_SUCCESS, "index", document, flags))
+		return 0;
+
+	ok&= test_walk (document, flags);
+
+	for (i= 0; i < sizeof (missing) / sizeof (missing[0]); i++)
+		ok&= check (sxml_find_attribute (document, tokens, slots, NUM_SLOTS, missing[i], (UINT) strlen (missing[i])) == NULL, "missing key found", document, flags);
+
+	/* The value of 'bb' is three tokens unless coalesced */
+	attr= sxml_find_attribute (document, tokens, slots, NUM_SLOTS, "bb", 2);
+	if (attr != NULL)
+	{
+		ok&= check (attr->nvalues == ((flags & SXML_FLAG_COALESCE) ? 1u : 3u), "number of value tokens", document, flags);
+		ok&= check (attr_value (document, tokens, attr, value) == 9 && strcmp (value, "x &amp; y") == 0, "value text", document, flags);
+	}
+
+	/* Same hash - the key text decides */
+	attr= sxml_find_attribute (document, tokens, slots, NUM_SLOTS, "glbvs", 5);
+	if (attr != NULL)
+		ok&= check (attr_value (document, tokens, attr, value) == 1 && strcmp (value, "1") == 0, "colliding key 'glbvs'", document, flags);
+
+	attr= sxml_find_attribute (document, tokens, slots, NUM_SLOTS, "yacxa", 5);
+	if (attr != NULL)
+		ok&= check (attr_value (document, tokens, attr, value) == 1 && strcmp (value, "2") == 0, "colliding key 'yacxa'", document, flags);
+
+	return ok;
+}
+
+/* MARK: main */
+
+int main (void)
+{
+	static const char* documents[]=
+	{
+		"<e a='1' bb=\"x &amp; y\" c='' d='v'/>",
+		"<e glbvs='1' yacxa='2' bb='x &amp; y'/>",
+		"<e yacxa='2' glbvs='1'></e>",
+		"<e/>",
+		"<e></e>"
+	};
+
+	UINT i, flags;
+	int ok= 1;
+
+	for (i= 0; i < sizeof (documents) / sizeof (documents[0]); i++)
+	for (flags= 0; flags <= SXML_FLAG_COALESCE; flags+= SXML_FLAG_COALESCE)
+		ok&= test_document (documents[i], flags);
+
+	/* One slot is always kept free */
+	{
+		const char* document= documents[0];
+		sxml_t parser;
+
+		sxml_init (&parser);
+		sxml_parse (&parser, document, (UINT) strlen (document), tokens, 256);
+		ok&= check (sxml_index_attributes (document, tokens, slots, 4) == SXML_ERROR_TOKENSFULL, "4 attributes in 4 slots", document, 0);
+		ok&= check (sxml_index_attributes (document, tokens, slots, 8) == SXML_SUCCESS, "4 attributes in 8 slots", document, 0);
+
+		document= documents[3];
+		sxml_init (&parser);
+		sxml_parse (&parser, document, (UINT) strlen (document), tokens, 256);
+		ok&= check (sxml_index_attributes (document, tokens, slots, 1) == SXML_SUCCESS &&
+			sxml_find_attribute (document, tokens, slots, 1, "a", 1) == NULL, "no attributes in 1 slot", document, 0);
+	}
+
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include "sxml_constexpr.hpp"
+
+#include <cstring>	/* std::memcmp, std::strlen */
+#include <cstdio>	/* std::printf */
+#include <cstdlib>	/* EXIT_SUCCESS, EXIT_FAILURE */
+
+/*
+ --- Constexpr test ---
+ The C++ port has to follow sxml.c exactly, or embedded XML would be tokenized differently from the same XML read at run time.
+ sxml::parse() is run side by side with sxml_parse() on a set of documents - for every combination of flags and skip mask,
+ on every prefix of each document and with token tables of 1 to 7 tokens.
+ The parser state and the tokens have to be identical after each call.
+
+ Usage: sxml_test_constexpr
+
+ Prints 'ok' and returns zero if both parsers agree.
+ Requires C++20 - link with sxml.c.
+*/
+
+namespace
+{
+	const char* documents[]=
+	{
+		"<?xml version='1.0'?>\n<!DOCTYPE r>\n<!-- c -->\n<r a='1' b=\"x &amp; y\">\n  text &lt; more <![CDATA[ <raw> ]]>\n  <e/><?pi data?>\n</r>\n",
+		"<p>Tom &amp;   </p>",
+		"<a>caf\xc3\xa9 &#233; \xe2\x82\xac</a>",
+		"<a>bad \xc3\x28 utf-8</a>",
+		"<a k='v'/>\n<b>  </b>\n<?pi?>\n<c>x</c>",
+		"<a><b></a>",
+		"<a>\n\n  <b\n k='1'\n/>\n</a>",
+		"  <a>unterminated"
+	};
+
+	const unsigned num_tokensmax= 64;
+
+	bool compare (const char* document, unsigned len, unsigned flags, unsigned skipmask, unsigned num_tokens)
+	{
+		sxmltok_t ctokens[num_tokensmax], cpptokens[num_tokensmax];
+		sxml_t cparser, cppparser;
+
+		sxml_init (&cparser);
+		sxml::init (cppparser);
+		cparser.flags= cppparser.flags= flags;
+		cparser.skipmask= cppparser.skipmask= skipmask;
+
+		/* Keep calling while tokens are full, like a caller processing them would */
+		for (int calls= 0; calls < 1000; calls++)
+		{
+			sxmlerr_t cerr= sxml_parse (&cparser, document, len, ctokens, num_tokens);
+			sxmlerr_t cpperr= sxml::parse (cppparser, document, len, cpptokens, num_tokens);
+
+			if (cerr != cpperr || std::memcmp (&cparser, &cppparser, sizeof (sxml_t)) != 0 ||
+				std::memcmp (ctokens, cpptokens, cparser.ntokens * sizeof (sxmltok_t)) != 0)
+			{
+				std::printf ("Mismatch with flags %u, skipmask %u, %u tokens, prefix of %u bytes: %s\n", flags, skipmask, num_tokens, len, document);
+				std::printf ("sxml_parse() returned %d with %u tokens at %u, sxml::parse() returned %d with %u tokens at %u\n",
+					cerr, cparser.ntokens, cparser.bufferpos, cpperr, cppparser.ntokens, cppparser.bufferpos);
+				return false;
+			}
+
+			if (cerr != SXML_ERROR_TOKENSFULL || cparser.ntokens == 0)
+				return true;
+
+			cparser.ntokens= cppparser.ntokens= 0;
+		}
+
+		return true;
+	}
+
+	/* Embedded XML must give the tokens sxml_parse() gives at run time */
+	constexpr auto embedded= sxml::embed<"<config a=\"1 &amp; 2\"><port>80</port><!--c--><e/></config>", SXML_FLAG_COALESCE, SXML_TYPEMASK (SXML_COMMENT)>;
+
+	bool compare_embedded ()
+	{
+		sxmltok_t tokens[num_tokensmax];
+		sxml_t parser;
+
+		sxml_init (&parser);
+		parser.flags= SXML_FLAG_COALESCE;
+		parser.skipmask= SXML_TYPEMASK (SXML_COMMENT);
+
+		return sxml_parse (&parser, embedded.buffer, (unsigned) std::strlen (embedded.buffer), tokens, num_tokensmax) == SXML_SUCCESS &&
+			parser.ntokens == embedded.tokens.size () &&
+			std::memcmp (tokens, embedded.tokens.data (), parser.ntokens * sizeof (sxmltok_t)) == 0;
+	}
+}
+
+int main ()
+{
+	if (!compare_embedded ())
+	{
+		std::printf ("Embedded tokens differ from sxml_parse()\n");
+		return EXIT_FAILURE;
+	}
+
+	for (const char* document : documents)
+	{
+		unsigned documentlen= (unsigned) std::strlen (document);
+
+		for (unsigned flags= 0; flags < 32; flags++)
+		for (unsigned skipmask= 0; skipmask < 256; skipmask++)
+		{
+			for (unsigned len= 0; len <= documentlen; len++)
+			{
+				if (!compare (document, len, flags, skipmask, num_tokensmax))
+					return EXIT_FAILURE;
+			}
+
+			for (unsigned num_tokens= 1; num_tokens < 8; num_tokens++)
+			{
+				if (!compare (document, documentlen, flags, skipmask, num_tokens))
+					return EXIT_FAILURE;
+			}
+		}
+	}
+
+	std::printf ("ok\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+#include "sxml_json.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned UINT;
+
+/*
+ --- JSON test ---
+ The JSON written for a document must not depend on how the input was split between calls.
+ A generated stream of documents is converted once with all of it in the buffer, and again with buffers from 64 bytes up and a small token table.
+ A short example is also checked against the output given in sxml_json.h.
+
+ Usage: sxml_test_json
+
+ Prints 'ok' and returns zero if all conversions agree.
+*/
+
+/* MARK: Output */
+
+#define OUTPUT_MAXLEN	(1024 * 1024)
+
+typedef struct output_t output_t;
+struct output_t
+{
+	char data[OUTPUT_MAXLEN];
+	UINT len;
+};
+
+static void output_write (void* user, const char* data, UINT len)
+{
+	output_t* out= (output_t*) user;
+	if (OUTPUT_MAXLEN - out->len < len)
+	{
+		fprintf (stderr, "Output too large\n");
+		exit (EXIT_FAILURE);
+	}
+
+	memcpy (out->data + out->len, data, len);
+	out->len+= len;
+}
+
+/* MARK: Input */
+
+#define INPUT_MAXLEN	(128 * 1024)
+
+static char input[INPUT_MAXLEN];
+static UINT inputlen;
+
+static void input_generate (UINT documents)
+{
+	UINT i;
+
+	inputlen= 0;
+	for (i= 0; i < documents; i++)
+	{
+		inputlen+= (UINT) sprintf (input + inputlen,
+			"<?xml version=\"1.0\"?>\n"
+			"<feed n=\"%u\">\n"
+			"  <entry id='%u' title=\"Tom &amp; Jerry &#x263A;\"><!-- skipped -->\n"
+			"    <text>caf\xc3\xa9 &lt;%u&gt; \"quoted\"\ttab</text>\n"
+			"    <![CDATA[raw <b>%u</b> \\ backslash]]>\n"
+			"    <empty/><mixed>a<b>b</b>c</mixed>\n"
+			"  </entry>\n"
+			"</feed>\n", i, i, i, i);
+	}
+}
+
+/* MARK: Conversion */
+
+#define BUFFER_MAXLEN	INPUT_MAXLEN
+
+static char buffer[BUFFER_MAXLEN];
+static sxmltok_t tokens[16 * 1024];
+
+static int convert (output_t* out, const char* data, UINT datalen, UINT flags, UINT recorddepth, const char* textkey, UINT buffersize, UINT num_tokens)
+{
+	UINT bufferlen= 0, pos= 0;
+	sxml_t parser;
+	sxmljson_t json;
+
+	sxml_init (&parser);
+	parser.flags= flags;
+
+	sxml_json_init (&json);
+	json.recorddepth= recorddepth;
+	json.textkey= textkey;
+	json.write= output_write;
+	json.user= out;
+
+	out->len= 0;
+	for (;;)
+	{
+		sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, num_tokens);
+		if (sxml_json_write (&json, buffer, tokens, parser.ntokens) != SXML_SUCCESS)
+			return 0;
+
+		parser.ntokens= 0;
+		switch (err)
+		{
+			case SXML_SUCCESS:
+				return 1;
+
+			case SXML_ERROR_TOKENSFULL:
+				break;
+
+			case SXML_ERROR_BUFFERDRY:
+			{
+				UINT n= buffersize - (bufferlen - parser.bufferpos);
+
+				bufferlen-= parser.bufferpos;
+				memmove (buffer, buffer + parser.bufferpos, bufferlen);
+				parser.bufferpos= 0;
+
+				if (datalen - pos < n)
+					n= datalen - pos;
+
+				/* Input may end between any two documents */
+				if (n == 0)
+					return (flags & SXML_FLAG_STREAM) && parser.taglevel == 0 && bufferlen == 0;
+
+				memcpy (buffer + bufferlen, data + pos, n);
+				pos+= n;
+				bufferlen+= n;
+				break;
+			}
+
+			default:
+				return 0;
+		}
+	}
+}
+
+/* MARK: main */
+
+static output_t whole, split;
+
+int main (void)
+{
+	static const UINT flagsets[]=
+	{
+		SXML_FLAG_STREAM,
+		SXML_FLAG_STREAM | SXML_FLAG_COALESCE,
+		SXML_FLAG_STREAM | SXML_FLAG_NOSPACE | SXML_FLAG_UTF8,
+		SXML_FLAG_STREAM | SXML_FLAG_NOSPACE | SXML_FLAG_COALESCE | SXML_FLAG_LINES
+	};
+
+	const char* example= "<item id='7'>Hello <b>there</b></item>";
+	const char* expected= "{\"#name\":\"item\",\"@id\":\"7\",\"#children\":[\"Hello \",{\"#name\":\"b\",\"#children\":[\"there\"]}]}\n";
+	UINT i, depth, buffersize;
+
+	if (!convert (&whole, example, (UINT) strlen (example), 0, 0, NULL, BUFFER_MAXLEN, 1024) ||
+		whole.len != strlen (expected) || memcmp (whole.data, expected, whole.len) != 0)
+	{
+		printf ("Example converted to: %.*s\n", (int) whole.len, whole.data);
+		return EXIT_FAILURE;
+	}
+
+	input_generate (100);
+
+	for (i= 0; i < sizeof (flagsets) / sizeof (flagsets[0]); i++)
+	for (depth= 0; depth < 3; depth++)
+	{
+		const char* textkey= (depth == 2) ? "#text" : NULL;
+		if (!convert (&whole, input, inputlen, flagsets[i], depth, textkey, BUFFER_MAXLEN, 16 * 1024))
+		{
+			printf ("Conversion failed with flags %u, depth %u\n", flagsets[i], depth);
+			return EXIT_FAILURE;
+		}
+
+		for (buffersize= 64; buffersize < 1024; buffersize+= 37)
+		{
+			if (!convert (&split, input, inputlen, flagsets[i], depth, textkey, buffersize, 16) ||
+				split.len != whole.len || memcmp (split.data, whole.data, whole.len) != 0)
+			{
+				printf ("Mismatch with flags %u, depth %u, buffer of %u bytes\n", flagsets[i], depth, buffersize);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
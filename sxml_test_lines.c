@@ -0,0 +1,154 @@
+#include "sxml_lines.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Line index test ---
+ sxml_find_line() must give the same line and column as counting newlines from the start of the buffer.
+ It is checked at the start and end of every token and at the first and last byte, with strides from one byte to more than the whole document.
+ SXML_FLAG_LINES must agree with the same count wherever the parser stops, with input that arrives one byte at a time.
+ The documents include CRLF line ends - the '\r' counts as a column - and a last line without a newline.
+
+ Usage: sxml_test_lines
+
+ Prints 'ok' and returns zero if all counts agree.
+*/
+
+#define NUM_TOKENS	256
+#define MAX_LEN	1024
+
+static sxmltok_t tokens[NUM_TOKENS];
+static UINT lines[MAX_LEN + 1];
+
+/* Counts newlines one byte at a time */
+static void naive_line (const char* buffer, UINT offset, UINT* lineno, UINT* colno)
+{
+	UINT i;
+
+	*lineno= *colno= 1;
+	for (i= 0; i < offset; i++)
+	{
+		if (buffer[i] == '\n')
+		{
+			(*lineno)++;
+			*colno= 1;
+		}
+		else
+		{
+			(*colno)++;
+		}
+	}
+}
+
+static int check_offset (const char* document, UINT stride, UINT offset)
+{
+	UINT lineno, colno, expectedlineno, expectedcolno;
+
+	sxml_find_line (document, stride, lines, offset, &lineno, &colno);
+	naive_line (document, offset, &expectedlineno, &expectedcolno);
+
+	if (lineno == expectedlineno && colno == expectedcolno)
+		return 1;
+
+	printf ("Offset %u with stride %u is at %u:%u, expected %u:%u in %s\n", offset, stride, lineno, colno, expectedlineno, expectedcolno, document);
+	return 0;
+}
+
+static int test_index (const char* document, UINT ntokens)
+{
+	static const UINT strides[]= {1, 2, 3, 7, 8, 16, 64, 4096};
+
+	UINT len= (UINT) strlen (document);
+	UINT i, j;
+	int ok= 1;
+
+	for (i= 0; i < sizeof (strides) / sizeof (strides[0]); i++)
+	{
+		UINT stride= strides[i];
+		sxml_index_lines (document, len, stride, lines);
+
+		ok&= check_offset (document, stride, 0);
+		ok&= check_offset (document, stride, len - 1);
+		ok&= check_offset (document, stride, len);
+
+		for (j= 0; j < ntokens; j++)
+		{
+			ok&= check_offset (document, stride, tokens[j].startpos);
+			ok&= check_offset (document, stride, tokens[j].endpos);
+		}
+	}
+
+	return ok;
+}
+
+/* Parser position is compared after every call - each one counts lines over the text it got further */
+static int test_flag (const char* document)
+{
+	UINT len, bufferlen= (UINT) strlen (document);
+	sxml_t parser;
+	sxmlerr_t err= SXML_ERROR_BUFFERDRY;
+
+	sxml_init (&parser);
+	parser.flags= SXML_FLAG_LINES;
+
+	for (len= 0; len <= bufferlen && err == SXML_ERROR_BUFFERDRY; len++)
+	{
+		UINT lineno, colno;
+
+		err= sxml_parse (&parser, document, len, tokens, NUM_TOKENS);
+		parser.ntokens= 0;
+
+		naive_line (document, parser.bufferpos, &lineno, &colno);
+		if (parser.lineno != lineno || parser.colno != colno)
+		{
+			printf ("Parser at %u is at %u:%u, expected %u:%u in %s\n", parser.bufferpos, parser.lineno, parser.colno, lineno, colno, document);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* MARK: main */
+
+int main (void)
+{
+	static const char* documents[]=
+	{
+		"<?xml version='1.0'?>\n<list>\n\t<item id='1'>one</item>\n\t<item id='2'>two\nlines</item>\n</list>\n",
+		"<?xml version='1.0'?>\r\n<list>\r\n\t<item id='1'>one</item>\r\n\t<item\r\n\t\tid='2'>two\r\nlines</item>\r\n</list>\r\n",
+		"<a>\n<b/>\n</a>",
+		"\n\n\n<a>\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n</a>\n\n",
+		"<a>text on the first line that runs on past a few words of the scan</a>",
+		"<a>\n</a>"
+	};
+
+	UINT i;
+	int ok= 1;
+
+	for (i= 0; i < sizeof (documents) / sizeof (documents[0]); i++)
+	{
+		const char* document= documents[i];
+		sxml_t parser;
+
+		sxml_init (&parser);
+		if (sxml_parse (&parser, document, (UINT) strlen (document), tokens, NUM_TOKENS) != SXML_SUCCESS)
+		{
+			printf ("Failed to parse %s\n", document);
+			return EXIT_FAILURE;
+		}
+
+		ok&= test_index (document, parser.ntokens);
+		ok&= test_flag (document);
+	}
+
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#ifndef _SXML_TEST_OUTPUT_H_INCLUDED
+#define _SXML_TEST_OUTPUT_H_INCLUDED
+
+#include "sxml.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ --- Test output ---
+ Shared by the tests that compare tokens handed out a few at a time with the tokens of a single call to sxml_parse().
+ Tokens are written out as text, so two runs are compared with memcmp() and a mismatch can be printed as is.
+ Adjacent SXML_CHARACTER tokens are merged - a run of text may be split anywhere.
+*/
+
+typedef struct output_t output_t;
+struct output_t
+{
+	char* data;
+	unsigned size;
+	unsigned len;
+	int intext;	/* Last token written was a SXML_CHARACTER */
+};
+
+static void output_init (output_t* out, char* data, unsigned size)
+{
+	out->data= data;
+	out->size= size;
+	out->len= 0;
+	out->intext= 0;
+}
+
+static void output_write (output_t* out, const char* data, unsigned len)
+{
+	if (out->size - out->len < len)
+	{
+		fprintf (stderr, "Output too large\n");
+		exit (EXIT_FAILURE);
+	}
+
+	memcpy (out->data + out->len, data, len);
+	out->len+= len;
+}
+
+static void output_tokens (output_t* out, const char* buffer, const sxmltok_t tokens[], unsigned num_tokens)
+{
+	unsigned i, j;
+
+	for (i= 0; i < num_tokens; i++)
+	{
+		const sxmltok_t* token= tokens + i;
+		if (token->type == SXML_CHARACTER && token->size == 0)
+		{
+			if (!out->intext)
+				output_write (out, "\ntext:", 6);
+
+			output_write (out, buffer + token->startpos, token->endpos - token->startpos);
+			out->intext= 1;
+			continue;
+		}
+
+		/* Attributes are never split - a start tag is written along with them */
+		out->intext= 0;
+		for (j= 0; j <= token->size; j++)
+		{
+			char header[32];
+			sprintf (header, "\n%d/%d:", token[j].type, token[j].size);
+			output_write (out, header, (unsigned) strlen (header));
+			output_write (out, buffer + token[j].startpos, token[j].endpos - token[j].startpos);
+		}
+
+		i+= token->size;
+	}
+}
+
+static int output_equal (const output_t* a, const output_t* b)
+{
+	return a->len == b->len && memcmp (a->data, b->data, a->len) == 0;
+}
+
+#endif /* _SXML_TEST_OUTPUT_H_INCLUDED */
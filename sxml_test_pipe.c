@@ -0,0 +1,253 @@
+#include "sxml_pipe.h"
+#include "sxml_test_output.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>	/* pthread_create, pthread_join */
+#include <sched.h>	/* sched_yield */
+#include <limits.h>	/* UINT_MAX */
+
+typedef unsigned UINT;
+
+/*
+ --- Pipe test ---
+ The batches passed through the pipe must describe the same tokens as parsing the whole input in one call.
+ A generated document is read in pieces of varying size, and tokenized with segments and token tables of several sizes.
+ The consumer writes out each batch as text - adjacent SXML_CHARACTER tokens are merged, as a run of text may be split between batches.
+
+ In some runs the consumer holds on to each batch for a while, so the ring is full and the parser thread has to wait.
+ A batch must not change while the consumer holds it, and no more batches may be published than the ring holds.
+ The batch counters of these runs start just below UINT_MAX, so they wrap around during the run.
+
+ Usage: sxml_test_pipe
+
+ Prints 'ok' and returns zero if all runs agree.
+ Requires C11 atomics and POSIX threads. Build it with -fsanitize=thread as well to check the memory ordering of the ring:
+
+ cc -std=c11 -fsanitize=thread -g sxml.c sxml_pipe.c sxml_test_pipe.c -lpthread
+*/
+
+#define NUM_BATCHES	4
+#define SEGMENT_MAXLEN	4096
+
+/* MARK: Output */
+
+#define OUTPUT_MAXLEN	(1024 * 1024)
+
+static void output_result (output_t* out, sxmlerr_t err)
+{
+	char result[16];
+	sprintf (result, "\nresult %d", err);
+	output_write (out, result, (UINT) strlen (result));
+}
+
+/* MARK: Input */
+
+#define INPUT_MAXLEN	(256 * 1024)
+
+static char input[INPUT_MAXLEN];
+static UINT inputlen;
+
+static void input_generate (UINT items)
+{
+	UINT i;
+
+	inputlen= (UINT) sprintf (input, "<?xml version=\"1.0\"?>\n<root>\n");
+	for (i= 0; i < items; i++)
+	{
+		inputlen+= (UINT) sprintf (input + inputlen,
+			"  <item id=\"%u\" note='a &lt; b'>\n"
+			"    <name>Item &amp; %u</name><!-- %u -->\n"
+			"    <![CDATA[<raw %u>]]>%s\n"
+			"  </item>\n", i, i, i, i, (i % 7 == 0) ? " long text that runs on and on and on past the smallest segments" : "");
+	}
+
+	inputlen+= (UINT) sprintf (input + inputlen, "</root>\n");
+}
+
+typedef struct reader_t reader_t;
+struct reader_t
+{
+	UINT pos;
+	UINT seed;
+};
+
+/* Hands out the input in pieces of 1 to 997 bytes */
+static UINT reader_read (void* user, char* buffer, UINT len)
+{
+	reader_t* reader= (reader_t*) user;
+	UINT n;
+
+	reader->seed= reader->seed * 1103515245u + 12345u;
+	n= (reader->seed >> 16) % 997 + 1;
+
+	if (len < n)
+		n= len;
+	if (inputlen - reader->pos < n)
+		n= inputlen - reader->pos;
+
+	memcpy (buffer, input + reader->pos, n);
+	reader->pos+= n;
+	return n;
+}
+
+static atomic_uint waits;	/* Times the parser thread found all batches in use */
+
+static void reader_wait (void* user)
+{
+	(void) user;
+	atomic_fetch_add (&waits, 1);
+	sched_yield ();
+}
+
+/* MARK: Runs */
+
+static sxmlpipe_t xmlpipe;
+static sxmlbatch_t batches[NUM_BATCHES];
+static char segments[NUM_BATCHES][SEGMENT_MAXLEN];
+static sxmltok_t tables[NUM_BATCHES][SEGMENT_MAXLEN];
+
+static char held[SEGMENT_MAXLEN];
+static char expecteddata[OUTPUT_MAXLEN], receiveddata[OUTPUT_MAXLEN];
+static output_t expected, received;
+
+static void* produce (void* user)
+{
+	sxmlsource_t source;
+	reader_t reader;
+
+	reader.pos= 0;
+	reader.seed= 1;
+
+	source.read= reader_read;
+	source.wait= reader_wait;
+	source.user= &reader;
+
+	*(sxmlerr_t*) user= sxml_pipe_produce (&xmlpipe, &source);
+	return NULL;
+}
+
+/* 'start' is the first value of the batch counters - 'hold' is the number of times the consumer yields before releasing a batch */
+static int run (UINT flags, UINT segmentsize, UINT num_tokens, UINT start, UINT hold)
+{
+	sxmlerr_t err, producererr;
+	pthread_t producer;
+	UINT i, num_batches= 0;
+	int ok= 1;
+
+	for (i= 0; i < NUM_BATCHES; i++)
+	{
+		batches[i].buffer= segments[i];
+		batches[i].buffersize= segmentsize;
+		batches[i].tokens= tables[i];
+		batches[i].num_tokens= num_tokens;
+	}
+
+	sxml_pipe_init (&xmlpipe, batches, NUM_BATCHES);
+	xmlpipe.parser.flags= flags;
+
+	/* Only the difference of the counters and their low bits are used - they may start anywhere */
+	atomic_store (&xmlpipe.head, start);
+	atomic_store (&xmlpipe.tail, start);
+	atomic_store (&waits, 0);
+
+	if (pthread_create (&producer, NULL, produce, &producererr) != 0)
+	{
+		fprintf (stderr, "Failed to start parser thread\n");
+		exit (EXIT_FAILURE);
+	}
+
+	output_init (&received, receiveddata, OUTPUT_MAXLEN);
+
+	do
+	{
+		const sxmlbatch_t* batch;
+		while ((batch= sxml_pipe_acquire (&xmlpipe)) == NULL)
+			sched_yield ();
+
+		memcpy (held, batch->buffer, batch->bufferlen);
+		for (i= 0; i < hold; i++)
+		{
+			if (atomic_load (&xmlpipe.head) - atomic_load (&xmlpipe.tail) > NUM_BATCHES)
+				ok= 0;
+
+			sched_yield ();
+		}
+
+		if (memcmp (held, batch->buffer, batch->bufferlen) != 0)
+			ok= 0;
+
+		output_tokens (&received, batch->buffer, batch->tokens, batch->ntokens);
+		err= batch->err;
+		sxml_pipe_release (&xmlpipe);
+		num_batches++;
+	}
+	while (err != SXML_SUCCESS && err != SXML_ERROR_XMLINVALID);
+
+	pthread_join (producer, NULL);
+	output_result (&received, err);
+
+	if (!ok)
+	{
+		printf ("Parser thread overran the consumer with segments of %u bytes and %u tokens\n", segmentsize, num_tokens);
+		return 0;
+	}
+
+	/* A slow consumer makes the parser thread wait for a free batch - and the counters wrap around */
+	if (hold != 0 && (atomic_load (&waits) == 0 || start <= start + num_batches))
+	{
+		printf ("Ring was not full or did not wrap around in %u batches\n", num_batches);
+		return 0;
+	}
+
+	if (producererr == err && output_equal (&received, &expected))
+		return 1;
+
+	printf ("Mismatch with flags %u, segments of %u bytes and %u tokens\n", flags, segmentsize, num_tokens);
+	return 0;
+}
+
+/* MARK: main */
+
+static sxmltok_t tokens[64 * 1024];
+
+int main (void)
+{
+	static const UINT segmentsizes[]= {128, 1000, SEGMENT_MAXLEN};
+	static const UINT tablesizes[]= {8, 100, SEGMENT_MAXLEN};
+	UINT flags, i, j;
+	int ok= 1;
+
+	input_generate (1000);
+
+	for (flags= 0; flags < 32; flags++)
+	{
+		sxml_t parser;
+		sxmlerr_t err;
+
+		sxml_init (&parser);
+		parser.flags= flags;
+
+		err= sxml_parse (&parser, input, inputlen, tokens, sizeof (tokens) / sizeof (tokens[0]));
+		if (err == SXML_ERROR_BUFFERDRY && (flags & SXML_FLAG_STREAM) && parser.taglevel == 0 && parser.bufferpos == inputlen)
+			err= SXML_SUCCESS;
+
+		output_init (&expected, expecteddata, OUTPUT_MAXLEN);
+		output_tokens (&expected, input, tokens, parser.ntokens);
+		output_result (&expected, err);
+
+		for (i= 0; i < sizeof (segmentsizes) / sizeof (segmentsizes[0]); i++)
+		for (j= 0; j < sizeof (tablesizes) / sizeof (tablesizes[0]); j++)
+			ok&= run (flags, segmentsizes[i], tablesizes[j], 0, 0);
+
+		if (flags == 0 || flags == SXML_FLAG_COALESCE)
+			ok&= run (flags, 128, 8, UINT_MAX - 2 * NUM_BATCHES, 20);
+	}
+
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
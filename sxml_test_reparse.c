@@ -0,0 +1,197 @@
+#include "sxml_reparse.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Reparse test ---
+ sxml_reparse() must leave the same tokens as parsing the edited document from scratch.
+ Random documents get a random edit - often one that breaks the document or changes where elements end.
+ After each edit the result of sxml_reparse() is compared with a full parse of the new text - including the line and column with SXML_FLAG_LINES.
+ When sxml_reparse() fails, the parser and tokens must be left as they were.
+
+ Usage: sxml_test_reparse [iterations]
+
+ Runs 'iterations' edits (default 20000) for each combination of parser flags.
+ Prints 'ok' and returns zero if all of them agree.
+*/
+
+#define DOCUMENT_MAXLEN	20000
+#define NUM_TOKENS	4000
+
+static char document[DOCUMENT_MAXLEN], edited[DOCUMENT_MAXLEN];
+static UINT documentlen;
+
+static sxmltok_t tokens[NUM_TOKENS], backup[NUM_TOKENS], expected[NUM_TOKENS];
+
+/* MARK: Documents */
+
+static void document_write (const char* text)
+{
+	UINT len= (UINT) strlen (text);
+	memcpy (document + documentlen, text, len);
+	documentlen+= len;
+}
+
+static void document_element (UINT depth)
+{
+	static const char* names[]= {"a", "bb", "c", "dd"};
+	const char* name= names[rand () % 4];
+	char text[64];
+	int i, n;
+
+	sprintf (text, "<%s", name);
+	document_write (text);
+
+	for (i= rand () % 3; 0 < i; i--)
+	{
+		sprintf (text, " k%d='v%d%s'", i, rand () % 10, (rand () % 3 != 0) ? "" : " &amp; x");
+		document_write (text);
+	}
+
+	if (4 < depth || (0 < depth && rand () % 4 == 0))
+	{
+		document_write ("/>");
+		return;
+	}
+
+	document_write (">");
+	for (n= rand () % 4; 0 < n; n--)
+	{
+		switch (rand () % 5)
+		{
+		case 0:	document_write ("text &lt; t");	break;
+		case 1:	document_write ("\n  ");	break;
+		case 2:	document_write ("<!-- c -->");	break;
+		default:	document_element (depth + 1);	break;
+		}
+	}
+
+	sprintf (text, "</%s>", name);
+	document_write (text);
+}
+
+static void document_generate (void)
+{
+	documentlen= 0;
+	if (rand () % 2 == 0)
+		document_write ("<?xml version='1.0'?>\n");
+
+	document_element (0);
+}
+
+/* MARK: Parsing */
+
+static sxmlerr_t parse (sxml_t* parser, UINT flags, const char* buffer, UINT bufferlen, sxmltok_t* tokens)
+{
+	sxmlerr_t err;
+
+	sxml_init (parser);
+	parser->flags= flags;
+	err= sxml_parse (parser, buffer, bufferlen, tokens, NUM_TOKENS);
+
+	/* A stream of documents ends where the buffer does */
+	if (err == SXML_ERROR_BUFFERDRY && (flags & SXML_FLAG_STREAM) && parser->taglevel == 0 && parser->bufferpos == bufferlen)
+		err= SXML_SUCCESS;
+
+	return err;
+}
+
+static int test_edit (UINT flags, int iteration)
+{
+	static const char* inserts[]= {"x", "<", "<b/>", "</a>", "&amp;", "'", "  ", "<bb k='1'>", "</bb>", "<!--", "-->", ">", "\xc3\xa9", "\n\n"};
+
+	sxml_t parser, saved, full;
+	sxmlerr_t err, fullerr;
+	UINT editpos, oldlen, newlen, editedlen;
+	const char* insert;
+
+	document_generate ();
+	if (parse (&parser, flags, document, documentlen, tokens) != SXML_SUCCESS)
+	{
+		printf ("Generated document does not parse: %.*s\n", (int) documentlen, document);
+		return 0;
+	}
+
+	/* Replace up to 3 bytes anywhere in the document - sometimes with nothing */
+	editpos= (UINT) rand () % (documentlen + 1);
+	oldlen= (UINT) rand () % 4;
+	if (documentlen - editpos < oldlen)
+		oldlen= documentlen - editpos;
+
+	insert= inserts[rand () % (sizeof (inserts) / sizeof (inserts[0]))];
+	newlen= (rand () % 3 != 0) ? (UINT) strlen (insert) : 0;
+
+	memcpy (edited, document, editpos);
+	memcpy (edited + editpos, insert, newlen);
+	memcpy (edited + editpos + newlen, document + editpos + oldlen, documentlen - editpos - oldlen);
+	editedlen= documentlen - oldlen + newlen;
+
+	fullerr= parse (&full, flags, edited, editedlen, expected);
+
+	saved= parser;
+	memcpy (backup, tokens, parser.ntokens * sizeof (sxmltok_t));
+
+	err= sxml_reparse (&parser, edited, editedlen, tokens, NUM_TOKENS, editpos, oldlen, newlen);
+	if (err != SXML_SUCCESS)
+	{
+		if (memcmp (&saved, &parser, sizeof (sxml_t)) != 0 || memcmp (backup, tokens, saved.ntokens * sizeof (sxmltok_t)) != 0)
+		{
+			printf ("Iteration %d, flags %u: parser or tokens changed by failed reparse\n", iteration, flags);
+			return 0;
+		}
+
+		if (fullerr == SXML_SUCCESS)
+		{
+			printf ("Iteration %d, flags %u: reparse failed with %d, full parse succeeded\n", iteration, flags, err);
+			return 0;
+		}
+
+		return 1;
+	}
+
+	/* Edits after the end of the document are not looked at */
+	if (fullerr != SXML_SUCCESS)
+	{
+		if (editpos < saved.bufferpos)
+		{
+			printf ("Iteration %d, flags %u: reparse succeeded, full parse failed with %d\n", iteration, flags, fullerr);
+			return 0;
+		}
+
+		return 1;
+	}
+
+	if (parser.ntokens != full.ntokens || parser.bufferpos != full.bufferpos || parser.lineno != full.lineno || parser.colno != full.colno ||
+		memcmp (tokens, expected, full.ntokens * sizeof (sxmltok_t)) != 0)
+	{
+		printf ("Iteration %d, flags %u: tokens or position differ from full parse\n", iteration, flags);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* MARK: main */
+
+int main (int argc, const char* argv[])
+{
+	int i, iterations= (argc == 2) ? atoi (argv[1]) : 20000;
+	UINT flags;
+
+	srand (42);
+	for (flags= 0; flags < 32; flags++)
+	{
+		for (i= 0; i < iterations; i++)
+		{
+			if (!test_edit (flags, i))
+				return EXIT_FAILURE;
+		}
+	}
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,230 @@
+#include "sxml_test_output.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Split parsing test ---
+ The tokens of a document must not depend on how the work is split between calls to sxml_parse().
+ Each document is parsed in one call, and again with a small token table, with input that arrives one byte at a time and with a small work budget.
+ The output of each run is compared after merging adjacent SXML_CHARACTER tokens - splitting a run of text is allowed.
+
+ Usage: sxml_test_split
+
+ Prints 'ok' and returns zero if all runs agree.
+*/
+
+/* MARK: Output */
+
+static void output_result (output_t* out, const sxml_t* parser, sxmlerr_t err)
+{
+	char result[64];
+	sprintf (result, "\nresult %d at %u (%u:%u)", err, parser->bufferpos, parser->lineno, parser->colno);
+	output_write (out, result, (UINT) strlen (result));
+}
+
+/*
+ MARK: Runs
+ Each run returns FALSE if it could not make progress - a single token did not fit the token table.
+*/
+
+static sxmltok_t tokens[1024];
+
+static sxmlerr_t parse_end (const sxml_t* parser, sxmlerr_t err, UINT bufferlen)
+{
+	/* A stream of documents ends where the input does */
+	if (err == SXML_ERROR_BUFFERDRY && (parser->flags & SXML_FLAG_STREAM) && parser->taglevel == 0 && parser->bufferpos == bufferlen)
+		return SXML_SUCCESS;
+
+	return err;
+}
+
+static int run_whole (output_t* out, const sxml_t* init, const char* buffer, UINT bufferlen)
+{
+	sxml_t parser= *init;
+	sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, 1024);
+
+	output_tokens (out, buffer, tokens, parser.ntokens);
+	output_result (out, &parser, parse_end (&parser, err, bufferlen));
+	return err != SXML_ERROR_TOKENSFULL;
+}
+
+static int run_tokens (output_t* out, const sxml_t* init, const char* buffer, UINT bufferlen, UINT num_tokens)
+{
+	sxml_t parser= *init;
+
+	for (;;)
+	{
+		sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, num_tokens);
+		output_tokens (out, buffer, tokens, parser.ntokens);
+		if (err == SXML_ERROR_TOKENSFULL)
+		{
+			if (parser.ntokens == 0)
+				return 0;
+
+			parser.ntokens= 0;
+			continue;
+		}
+
+		output_result (out, &parser, parse_end (&parser, err, bufferlen));
+		return 1;
+	}
+}
+
+static int run_bytes (output_t* out, const sxml_t* init, const char* buffer, UINT bufferlen)
+{
+	sxml_t parser= *init;
+	UINT len= 0;
+
+	for (;;)
+	{
+		sxmlerr_t err= sxml_parse (&parser, buffer, len, tokens, 1024);
+		output_tokens (out, buffer, tokens, parser.ntokens);
+		parser.ntokens= 0;
+
+		if (err == SXML_ERROR_BUFFERDRY && len < bufferlen)
+		{
+			len++;
+			continue;
+		}
+
+		output_result (out, &parser, parse_end (&parser, err, bufferlen));
+		return err != SXML_ERROR_TOKENSFULL;
+	}
+}
+
+static int run_budget (output_t* out, const sxml_t* init, const char* buffer, UINT bufferlen, UINT bytebudget, UINT tokenbudget)
+{
+	sxml_t parser= *init;
+	parser.bytebudget= bytebudget;
+	parser.tokenbudget= tokenbudget;
+
+	for (;;)
+	{
+		sxmlerr_t err= sxml_parse (&parser, buffer, bufferlen, tokens, 1024);
+		output_tokens (out, buffer, tokens, parser.ntokens);
+		parser.ntokens= 0;
+
+		if (err == SXML_YIELD)
+			continue;
+
+		output_result (out, &parser, parse_end (&parser, err, bufferlen));
+		return err != SXML_ERROR_TOKENSFULL;
+	}
+}
+
+/* MARK: main */
+
+static const char* documents[]=
+{
+	"<p>Tom &amp;   </p>",
+	"<?xml version='1.0'?>\n<!-- list -->\n<list>\n\t<item id='1'>one</item>\n\t<item id='2' note='a &lt; b'>  two &amp; three  </item>\n\t<empty/>\n</list>\n",
+	"<a>\n  <b>  x  </b>  \n  &lt;  \n  <![CDATA[ <raw> ]]>\n  <?pi data?>\n</a>",
+	"<r>caf\xc3\xa9 &#233; \xe2\x82\xac</r>",
+	"<!DOCTYPE r><r><x k='v'/>text &amp;&amp; more<x/>   tail   </r>",
+	"<a>1</a>\n<b k='2'> </b>\n<?pi?>\n<c/>",
+	"<a><b></a>"
+};
+
+static const UINT skipmasks[]=
+{
+	0,
+	SXML_TYPEMASK (SXML_COMMENT) | SXML_TYPEMASK (SXML_INSTRUCTION) | SXML_TYPEMASK (SXML_DOCTYPE),
+	SXML_TYPEMASK (SXML_CHARACTER) | SXML_TYPEMASK (SXML_CDATA)
+};
+
+static const UINT bytebudgets[]= {0, 1, 5, 17, 64};
+static const UINT tokenbudgets[]= {0, 1, 3};
+
+#define OUTPUT_MAXLEN	(64 * 1024)
+
+static char wholedata[OUTPUT_MAXLEN], splitdata[OUTPUT_MAXLEN];
+static output_t whole, split;
+
+static int compare (const char* document, UINT flags, UINT skipmask, const char* run)
+{
+	if (output_equal (&whole, &split))
+		return 1;
+
+	printf ("Mismatch %s, flags %u, skipmask %u: %s\n", run, flags, skipmask, document);
+	printf ("--- whole%.*s\n--- split%.*s\n", (int) whole.len, whole.data, (int) split.len, split.data);
+	return 0;
+}
+
+int main (void)
+{
+	UINT i, flags, skip, num_tokens, bytes, toks;
+	int ok= 1;
+
+	output_init (&whole, wholedata, OUTPUT_MAXLEN);
+	output_init (&split, splitdata, OUTPUT_MAXLEN);
+
+	/* The whitespace after a reference belongs to the text before it */
+	{
+		const char* document= documents[0];
+		sxml_t parser;
+		sxml_init (&parser);
+		parser.flags= SXML_FLAG_NOSPACE;
+
+		whole.len= split.len= whole.intext= split.intext= 0;
+		run_whole (&whole, &parser, document, (UINT) strlen (document));
+		if (!run_tokens (&split, &parser, document, (UINT) strlen (document), 3) || !compare (document, parser.flags, 0, "3 tokens"))
+			return EXIT_FAILURE;
+	}
+
+	for (i= 0; i < sizeof (documents) / sizeof (documents[0]); i++)
+	{
+		const char* document= documents[i];
+		UINT len= (UINT) strlen (document);
+
+		for (flags= 0; flags < 32; flags++)
+		for (skip= 0; skip < sizeof (skipmasks) / sizeof (skipmasks[0]); skip++)
+		{
+			sxml_t parser;
+			sxml_init (&parser);
+			parser.flags= flags;
+			parser.skipmask= skipmasks[skip];
+
+			whole.len= split.len= whole.intext= 0;
+			run_whole (&whole, &parser, document, len);
+
+			for (num_tokens= 1; num_tokens <= 8; num_tokens++)
+			{
+				char run[16];
+				split.len= split.intext= 0;
+				if (!run_tokens (&split, &parser, document, len, num_tokens))
+					continue;
+
+				sprintf (run, "%u tokens", num_tokens);
+				ok&= compare (document, flags, skipmasks[skip], run);
+			}
+
+			split.len= split.intext= 0;
+			run_bytes (&split, &parser, document, len);
+			ok&= compare (document, flags, skipmasks[skip], "bytewise");
+
+			for (bytes= 0; bytes < sizeof (bytebudgets) / sizeof (bytebudgets[0]); bytes++)
+			for (toks= 0; toks < sizeof (tokenbudgets) / sizeof (tokenbudgets[0]); toks++)
+			{
+				char run[48];
+				if (bytebudgets[bytes] == 0 && tokenbudgets[toks] == 0)
+					continue;
+
+				split.len= split.intext= 0;
+				run_budget (&split, &parser, document, len, bytebudgets[bytes], tokenbudgets[toks]);
+
+				sprintf (run, "budget of %u bytes, %u tokens", bytebudgets[bytes], tokenbudgets[toks]);
+				ok&= compare (document, flags, skipmasks[skip], run);
+			}
+		}
+	}
+
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
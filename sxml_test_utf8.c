@@ -0,0 +1,268 @@
+#include "sxml_utf16.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned UINT;
+
+/*
+ --- Encoding test ---
+ Checks the handling of text encodings, each piece against a known answer:
+ * sxml_detect_encoding() with and without a byte order mark
+ * sxml_utf16_to_utf8() on surrogate pairs, lone surrogates, and input and output cut anywhere
+ * SXML_FLAG_UTF8 rejecting invalid sequences with the exact 'errorpos'
+ * SXML_FLAG_UTF8 waiting for the rest of a multibyte sequence instead of splitting it between tokens
+
+ Usage: sxml_test_utf8
+
+ Prints 'ok' and returns zero if all checks pass.
+*/
+
+static int check (int ok, const char* what)
+{
+	if (!ok)
+		printf ("Failed: %s\n", what);
+
+	return ok;
+}
+
+/* MARK: Detection */
+
+static int test_detect (void)
+{
+	static const struct { const char* text; UINT len; sxmlenc_t encoding; UINT bomlen; } cases[]=
+	{
+		{"\xEF\xBB\xBF<?xml", 8, SXML_ENCODING_UTF8, 3},
+		{"\xFF\xFE<\0?\0", 6, SXML_ENCODING_UTF16LE, 2},
+		{"\xFE\xFF\0<\0?", 6, SXML_ENCODING_UTF16BE, 2},
+		{"<?xml", 5, SXML_ENCODING_UTF8, 0},
+		{"<\0?\0x\0", 6, SXML_ENCODING_UTF16LE, 0},
+		{"\0<\0?\0x", 6, SXML_ENCODING_UTF16BE, 0},
+		{"<root/>", 7, SXML_ENCODING_UTF8, 0},
+		{"\xFF\xFE", 2, SXML_ENCODING_UTF16LE, 2},
+		{"<\0?", 3, SXML_ENCODING_UTF8, 0},	/* Too short to tell */
+		{"", 0, SXML_ENCODING_UTF8, 0}
+	};
+
+	UINT i;
+	int ok= 1;
+
+	for (i= 0; i < sizeof (cases) / sizeof (cases[0]); i++)
+	{
+		UINT bomlen= 99;
+		sxmlenc_t encoding= sxml_detect_encoding (cases[i].text, cases[i].len, &bomlen);
+
+		if (encoding != cases[i].encoding || bomlen != cases[i].bomlen)
+		{
+			printf ("Detection of case %u gave encoding %d with %u byte mark\n", i, encoding, bomlen);
+			ok= 0;
+		}
+	}
+
+	return ok;
+}
+
+/* MARK: Transcoding */
+
+/* "<a>é€😀</a>" - the last character needs a surrogate pair */
+static const char utf16le[]= "<\0a\0>\0\xE9\0\xAC\x20\x3D\xD8\x00\xDE<\0/\0a\0>\0";
+static const char utf16be[]= "\0<\0a\0>\0\xE9\x20\xAC\xD8\x3D\xDE\x00\0<\0/\0a\0>";
+static const char expected[]= "<a>\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80</a>";
+
+#define UTF16_LEN	(sizeof (utf16le) - 1)
+
+/* Transcodes with input arriving 'chunk' bytes at a time into an output block of 'blocklen' bytes */
+static int transcode_split (sxmlenc_t encoding, const char* src, UINT chunk, UINT blocklen)
+{
+	char out[64], block[8];
+	UINT outlen= 0, srclen= 0, srcpos= 0;
+
+	for (;;)
+	{
+		UINT destpos= 0;
+		sxmlerr_t err= sxml_utf16_to_utf8 (encoding, src, srclen, &srcpos, block, blocklen, &destpos);
+		if (err != SXML_SUCCESS)
+			return 0;
+
+		memcpy (out + outlen, block, destpos);
+		outlen+= destpos;
+
+		if (destpos == 0)
+		{
+			if (srclen == UTF16_LEN)
+				break;
+
+			srclen= (UTF16_LEN - srclen < chunk) ? UTF16_LEN : srclen + chunk;
+		}
+	}
+
+	return srcpos == UTF16_LEN && outlen == sizeof (expected) - 1 && memcmp (out, expected, outlen) == 0;
+}
+
+static int test_transcode (void)
+{
+	char out[64];
+	UINT srcpos, destpos, chunk, blocklen;
+	int ok= 1;
+
+	/* Whole text in one call */
+	srcpos= destpos= 0;
+	ok&= check (sxml_utf16_to_utf8 (SXML_ENCODING_UTF16LE, utf16le, UTF16_LEN, &srcpos, out, sizeof (out), &destpos) == SXML_SUCCESS &&
+		srcpos == UTF16_LEN && destpos == sizeof (expected) - 1 && memcmp (out, expected, destpos) == 0, "utf-16le with surrogate pair");
+
+	srcpos= destpos= 0;
+	ok&= check (sxml_utf16_to_utf8 (SXML_ENCODING_UTF16BE, utf16be, UTF16_LEN, &srcpos, out, sizeof (out), &destpos) == SXML_SUCCESS &&
+		srcpos == UTF16_LEN && destpos == sizeof (expected) - 1 && memcmp (out, expected, destpos) == 0, "utf-16be with surrogate pair");
+
+	/* Input cut in the middle of a code unit or a surrogate pair, and output with no room for a whole character */
+	for (chunk= 1; chunk <= 5; chunk++)
+	for (blocklen= 4; blocklen <= 8; blocklen++)
+	{
+		ok&= check (transcode_split (SXML_ENCODING_UTF16LE, utf16le, chunk, blocklen), "utf-16le split input and output");
+		ok&= check (transcode_split (SXML_ENCODING_UTF16BE, utf16be, chunk, blocklen), "utf-16be split input and output");
+	}
+
+	/* Half of a code unit is left for the next block */
+	srcpos= destpos= 0;
+	ok&= check (sxml_utf16_to_utf8 (SXML_ENCODING_UTF16LE, utf16le, 7, &srcpos, out, sizeof (out), &destpos) == SXML_SUCCESS &&
+		srcpos == 6 && destpos == 3, "odd number of input bytes");
+
+	/* High surrogate at the end of the input waits for the low one */
+	srcpos= destpos= 0;
+	ok&= check (sxml_utf16_to_utf8 (SXML_ENCODING_UTF16LE, utf16le, 12, &srcpos, out, sizeof (out), &destpos) == SXML_SUCCESS &&
+		srcpos == 10 && destpos == 8, "high surrogate at end of input");
+
+	/* Unpaired surrogates */
+	srcpos= destpos= 0;
+	ok&= check (sxml_utf16_to_utf8 (SXML_ENCODING_UTF16LE, "a\0\x3D\xD8" "b\0", 6, &srcpos, out, sizeof (out), &destpos) == SXML_ERROR_XMLINVALID &&
+		srcpos == 2 && destpos == 1, "high surrogate followed by ascii");
+
+	srcpos= destpos= 0;
+	ok&= check (sxml_utf16_to_utf8 (SXML_ENCODING_UTF16BE, "\0a\xDE\x00\0b", 6, &srcpos, out, sizeof (out), &destpos) == SXML_ERROR_XMLINVALID &&
+		srcpos == 2 && destpos == 1, "lone low surrogate");
+
+	return ok;
+}
+
+/* MARK: Validation */
+
+static sxmltok_t tokens[64];
+
+static sxmlerr_t parse_utf8 (const char* buffer, UINT bufferlen, sxml_t* parser)
+{
+	sxml_init (parser);
+	parser->flags= SXML_FLAG_UTF8;
+	return sxml_parse (parser, buffer, bufferlen, tokens, sizeof (tokens) / sizeof (tokens[0]));
+}
+
+static int test_invalid (void)
+{
+	static const struct { const char* text; UINT errorpos; } cases[]=
+	{
+		{"<a>ok \xC0\xAF</a>", 6},	/* Overlong '/' */
+		{"<a>ok \xE0\x80\xAF</a>", 6},	/* Overlong '/' in 3 bytes */
+		{"<a>\xC3\xA9\xC3</a>", 5},	/* Sequence cut short by the end tag */
+		{"<a>\xE2\x82 x</a>", 3},	/* Sequence cut short by ascii */
+		{"<a>x\xC0</a>", 4},
+		{"<a>\xF5\x80\x80\x80</a>", 3},	/* Beyond U+10FFFF */
+		{"<a>\xF4\x90\x80\x80</a>", 3},
+		{"<a>\xED\xA0\x80</a>", 3},	/* Surrogate */
+		{"<a>\x80</a>", 3},	/* Continuation byte on its own */
+		{"<a k='v\xC0'/>", 7},	/* In an attribute value */
+		{"<a>&amp;\xFF</a>", 8}	/* After a reference */
+	};
+
+	UINT i;
+	int ok= 1;
+
+	for (i= 0; i < sizeof (cases) / sizeof (cases[0]); i++)
+	{
+		sxml_t parser;
+		sxmlerr_t err= parse_utf8 (cases[i].text, (UINT) strlen (cases[i].text), &parser);
+
+		if (err != SXML_ERROR_XMLINVALID || parser.errorpos != cases[i].errorpos)
+		{
+			printf ("Invalid case %u returned %d with 'errorpos' %u\n", i, err, parser.errorpos);
+			ok= 0;
+		}
+	}
+
+	/* Valid multibyte text is accepted - including the largest code point */
+	{
+		static const char* valid= "<a k='\xC3\xA9'>\xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF \xED\x9F\xBF</a>";
+		sxml_t parser;
+		ok&= check (parse_utf8 (valid, (UINT) strlen (valid), &parser) == SXML_SUCCESS, "valid utf-8");
+	}
+
+	return ok;
+}
+
+/*
+ MARK: Refill
+ The buffer is grown one byte at a time, so every multibyte sequence is at some point cut short by the end of the buffer.
+*/
+
+static int test_refill (UINT flags)
+{
+	static const char document[]= "<a>caf\xC3\xA9 \xE2\x82\xAC\xF0\x9F\x98\x80</a>";
+	static const char text[]= "caf\xC3\xA9 \xE2\x82\xAC\xF0\x9F\x98\x80";
+
+	char out[32];
+	UINT len, outlen= 0;
+	sxml_t parser;
+	sxmlerr_t err;
+
+	sxml_init (&parser);
+	parser.flags= SXML_FLAG_UTF8 | flags;
+
+	for (len= 0; len <= sizeof (document) - 1; len++)
+	{
+		UINT i;
+
+		err= sxml_parse (&parser, document, len, tokens, sizeof (tokens) / sizeof (tokens[0]));
+		for (i= 0; i < parser.ntokens; i++)
+		{
+			const sxmltok_t* token= tokens + i;
+			UINT tokenlen= token->endpos - token->startpos;
+
+			if (token->type != SXML_CHARACTER)
+				continue;
+
+			/* A token may not end in front of a continuation byte */
+			if ((document[token->endpos] & 0xC0) == 0x80)
+			{
+				printf ("Text token ends inside a multibyte sequence at %u with flags %u\n", token->endpos, flags);
+				return 0;
+			}
+
+			memcpy (out + outlen, document + token->startpos, tokenlen);
+			outlen+= tokenlen;
+		}
+
+		parser.ntokens= 0;
+		if (err != SXML_ERROR_BUFFERDRY)
+			break;
+	}
+
+	return check (err == SXML_SUCCESS && outlen == sizeof (text) - 1 && memcmp (out, text, outlen) == 0, "text split by refill");
+}
+
+/* MARK: main */
+
+int main (void)
+{
+	int ok= 1;
+
+	ok&= test_detect ();
+	ok&= test_transcode ();
+	ok&= test_invalid ();
+	ok&= test_refill (0);
+	ok&= test_refill (SXML_FLAG_COALESCE);
+
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf ("ok\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include "sxml_utf16.h"
+
+#include <string.h>	/* memcmp */
+#include <assert.h>	/* assert */
+
+typedef unsigned UINT;
+
+/*
+ MARK: Detection
+ Detection follows appendix F of the XML specification ( http://www.w3.org/TR/xml/#sec-guessing ).
+*/
+
+sxmlenc_t sxml_detect_encoding (const char* buffer, UINT bufferlen, UINT* bomlen)
+{
+	const unsigned char* b= (const unsigned char*) buffer;
+	*bomlen= 0;
+
+	if (2 <= bufferlen && b[0] == 0xFF && b[1] == 0xFE)
+	{
+		*bomlen= 2;
+		return SXML_ENCODING_UTF16LE;
+	}
+
+	if (2 <= bufferlen && b[0] == 0xFE && b[1] == 0xFF)
+	{
+		*bomlen= 2;
+		return SXML_ENCODING_UTF16BE;
+	}
+
+	if (3 <= bufferlen && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF)
+	{
+		*bomlen= 3;
+		return SXML_ENCODING_UTF8;
+	}
+
+	/* No byte order mark - look for '<?' of the xml declaration */
+	if (4 <= bufferlen && memcmp (b, "<\0?\0", 4) == 0)
+		return SXML_ENCODING_UTF16LE;
+
+	if (4 <= bufferlen && memcmp (b, "\0<\0?", 4) == 0)
+		return SXML_ENCODING_UTF16BE;
+
+	return SXML_ENCODING_UTF8;
+}
+
+/* MARK: Transcoding */
+
+#define UTF16_UNIT(p,enc)	((enc) == SXML_ENCODING_UTF16LE ? \
+	((UINT) (unsigned char) (p)[0] | (UINT) (unsigned char) (p)[1] << 8) : \
+	((UINT) (unsigned char) (p)[0] << 8 | (UINT) (unsigned char) (p)[1]))
+
+sxmlerr_t sxml_utf16_to_utf8 (sxmlenc_t encoding, const char* src, UINT srclen, UINT* srcpos, char* dest, UINT destlen, UINT* destpos)
+{
+	sxmlerr_t err= SXML_SUCCESS;
+	const char* it= src + *srcpos;
+	const char* end= src + srclen;
+	char* out= dest + *destpos;
+	char* outend= dest + destlen;
+	assert (encoding == SXML_ENCODING_UTF16LE || encoding == SXML_ENCODING_UTF16BE);
+	assert (*srcpos <= srclen && *destpos <= destlen);
+
+	while (2 <= end - it)
+	{
+		UINT c= UTF16_UNIT (it, encoding);
+		int nunits= 1;
+
+		/* Ascii is by far the most common case */
+		if (c < 0x80)
+		{
+			if (out == outend)
+				break;
+
+			*out++= (char) c;
+			it+= 2;
+			continue;
+		}
+
+		if (0xD800 <= c && c <= 0xDBFF)
+		{
+			UINT low;
+			if (end - it < 4)
+				break;
+
+			low= UTF16_UNIT (it + 2, encoding);
+			if (!(0xDC00 <= low && low <= 0xDFFF))
+			{
+				err= SXML_ERROR_XMLINVALID;
+				break;
+			}
+
+			c= 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+			nunits= 2;
+		}
+		else if (0xDC00 <= c && c <= 0xDFFF)
+		{
+			err= SXML_ERROR_XMLINVALID;
+			break;
+		}
+
+		if (c < 0x800)
+		{
+			if (outend - out < 2)
+				break;
+
+			*out++= (char) (0xC0 | c >> 6);
+		}
+		else if (c < 0x10000)
+		{
+			if (outend - out < 3)
+				break;
+
+			*out++= (char) (0xE0 | c >> 12);
+			*out++= (char) (0x80 | (c >> 6 & 0x3F));
+		}
+		else
+		{
+			if (outend - out < 4)
+				break;
+
+			*out++= (char) (0xF0 | c >> 18);
+			*out++= (char) (0x80 | (c >> 12 & 0x3F));
+			*out++= (char) (0x80 | (c >> 6 & 0x3F));
+		}
+
+		*out++= (char) (0x80 | (c & 0x3F));
+		it+= 2 * nunits;
+	}
+
+	*srcpos= (UINT) (it - src);
+	*destpos= (UINT) (out - dest);
+
+	return err;
+}
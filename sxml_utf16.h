@@ -0,0 +1,44 @@
+#ifndef _SXML_UTF16_H_INCLUDED
+#define _SXML_UTF16_H_INCLUDED
+
+#include "sxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ --- SXML utf-16 ---
+ Optional helper for XML text encoded in utf-16.
+ sxml_parse() only accepts ascii extensions - utf-16 text has to be transcoded to utf-8 before parsing.
+
+ Use sxml_detect_encoding() on the first bytes of the document (at least 4) to find out if it is necessary.
+ The encoding is detected from the byte order mark or from the byte pattern of the leading '<?xml' declaration.
+ 'bomlen' is set to the number of byte order mark bytes that you must skip - sxml_parse() does not expect them.
+*/
+
+typedef enum
+{
+	SXML_ENCODING_UTF8,		/* Also used for any other ascii extension - pass text to sxml_parse() as is */
+	SXML_ENCODING_UTF16LE,
+	SXML_ENCODING_UTF16BE
+} sxmlenc_t;
+
+sxmlenc_t sxml_detect_encoding(const char *buffer, unsigned bufferlen, unsigned *bomlen);
+
+/*
+ sxml_utf16_to_utf8() transcodes text one block at a time, so you can feed sxml_parse() from a stream of utf-16 data.
+ Text is read from 'src' starting at 'srcpos' and written to 'dest' starting at 'destpos' - both offsets are advanced.
+ Transcoding stops when there is no complete character left in 'src' or no room for the next character in 'dest'.
+
+ Keep any bytes after 'srcpos' for the next block, they may hold half of a character.
+ SXML_ERROR_XMLINVALID is returned for an unpaired surrogate - 'srcpos' is left pointing at it.
+*/
+
+sxmlerr_t sxml_utf16_to_utf8(sxmlenc_t encoding, const char *src, unsigned srclen, unsigned *srcpos, char *dest, unsigned destlen, unsigned *destpos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SXML_UTF16_H_INCLUDED */